@@ -0,0 +1,299 @@
+#include "board.hpp"
+#include "perft.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using namespace std;
+
+/*  micro benchmarks of the board hot paths on fixed workloads (the perft reference positions), built by runbench.sh.
+
+    every benchmark runs a workload many times (samples), and reports the median and the 99th percentile
+    of the time per operation over the samples, so single slow samples (scheduling, frequency changes)
+    don't move the result. a sample repeats short workloads until it takes at least 100 us, so the resolution
+    of the clock doesn't matter. the results are written to a file that a later run can compare against.
+
+    usage:
+        ./a.out [output file] [baseline file]       default output bench.txt, the baseline is a file of an earlier run
+*/
+
+struct BenchResult {
+    string name;
+    double median;      // ns per operation
+    double p99;
+    uint64_t ops;       // operations per sample
+};
+
+static volatile uint64_t sink;      // results of the workloads, so the compiler can't remove them
+
+const double MIN_SAMPLE_NS = 100000;
+
+// runs the workload samples times, the workload returns the number of operations it did
+template <typename Workload>
+static BenchResult bench(const string& name, int samples, Workload workload) {
+
+    vector<double> times;
+    uint64_t ops = 0;
+
+    // warm up caches and branch predictors, and find the repetitions per sample
+    auto start = chrono::steady_clock::now();
+    workload();
+    double once = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    int reps = max(1, int(MIN_SAMPLE_NS / max(once, 1.0)));
+
+    for (int i = 0; i < samples; i++) {
+
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < reps; r++) {
+            ops = workload();
+        }
+        auto end = chrono::steady_clock::now();
+
+        times.push_back(chrono::duration<double, nano>(end - start).count() / reps / max(ops, uint64_t(1)));
+    }
+
+    sort(times.begin(), times.end());
+
+    return BenchResult{name, times[times.size() / 2], times[min(times.size() - 1, times.size() * 99 / 100)], ops};
+}
+
+// fixed pseudo random numbers (xorshift), the same in every run
+static uint64_t rng = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random() {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static vector<BenchResult> run_benchmarks() {
+
+    vector<BenchResult> results;
+    vector<Board> boards;
+
+    for (int i = 0; i < perft_positions_num; i++) {
+        boards.emplace_back(perft_positions[i].fen);
+    }
+
+    results.push_back(bench("fen", 200, []() {
+
+        uint64_t sum = 0;
+
+        for (int i = 0; i < perft_positions_num; i++) {
+            Board b(perft_positions[i].fen);
+            sum += b.get_key();
+        }
+
+        sink = sum;
+        return uint64_t(perft_positions_num);
+    }));
+
+    // packed positions of the same positions, unpacking is the fast path of reading stored positions
+    vector<PackedPosition> packed(boards.size());
+
+    for (size_t i = 0; i < boards.size(); i++) {
+        boards[i].to_packed(packed[i]);
+    }
+
+    results.push_back(bench("set_packed", 1000, [&]() {
+
+        uint64_t sum = 0;
+        Board b;
+
+        for (const PackedPosition& p : packed) {
+            b.set_packed(p);
+            sum += b.get_key();
+        }
+
+        sink = sum;
+        return uint64_t(packed.size());
+    }));
+
+    results.push_back(bench("to_packed", 1000, [&]() {
+
+        uint64_t sum = 0;
+        PackedPosition p;
+
+        for (Board& b : boards) {
+            b.to_packed(p);
+            sum += p.pieces[0];
+        }
+
+        sink = sum;
+        return uint64_t(boards.size());
+    }));
+
+    results.push_back(bench("generate_moves", 1000, [&]() {
+
+        uint64_t sum = 0;
+        MoveList moves;
+
+        for (Board& b : boards) {
+            b.generate_moves(moves);
+            sum += moves.size;
+        }
+
+        sink = sum;
+        return uint64_t(boards.size());
+    }));
+
+    // possible_moves of every piece of one type
+    const char* type_names[] = {"", "pawn", "knight", "bishop", "rook", "queen", "king"};
+
+    for (int type = PAWN; type <= KING; type++) {
+
+        results.push_back(bench(string("possible_moves_") + type_names[type], 1000, [&]() {
+
+            uint64_t sum = 0, ops = 0;
+            MoveList moves;
+
+            for (Board& b : boards) {
+                for (Byte color : {WHITE, BLACK}) {
+
+                    Piece piece = Piece{s_Byte(type | color)};
+
+                    for (int i = 0; i < b.count(piece); i++) {
+                        moves.clear();
+                        b.possible_moves(b.squares(piece)[i], moves);
+                        sum += moves.size;
+                        ops++;
+                    }
+                }
+            }
+
+            sink = sum;
+            return ops;
+        }));
+    }
+
+    // make_move / unmake_move of every legal move
+    vector<MoveList> legal(boards.size());
+
+    for (size_t i = 0; i < boards.size(); i++) {
+        boards[i].generate_moves(legal[i]);
+    }
+
+    results.push_back(bench("make_unmake", 1000, [&]() {
+
+        uint64_t sum = 0, ops = 0;
+
+        for (size_t i = 0; i < boards.size(); i++) {
+            for (Move m : legal[i]) {
+                boards[i].make_move(m, false);
+                sum += boards[i].get_key();
+                boards[i].unmake_move(m);
+                ops++;
+            }
+        }
+
+        sink = sum;
+        return ops;
+    }));
+
+    // is_attacked on random squares for random colors
+    vector<pair<Byte, Byte>> squares(4096);
+
+    for (auto& sq : squares) {
+        sq = {board64[next_random() % 64], next_random() & 1 ? BLACK : WHITE};
+    }
+
+    results.push_back(bench("is_attacked", 1000, [&]() {
+
+        uint64_t sum = 0, ops = 0;
+
+        for (Board& b : boards) {
+            for (auto [square, color] : squares) {
+                sum += b.is_attacked(square, color);
+                ops++;
+            }
+        }
+
+        sink = sum;
+        return ops;
+    }));
+
+    // full perft, time per leaf node
+    results.push_back(bench("perft", 15, [&]() {
+
+        uint64_t nodes = 0;
+
+        for (int i = 0; i < perft_positions_num; i++) {
+            Board b(perft_positions[i].fen);
+            nodes += perft(b, 4);
+        }
+
+        return nodes;
+    }));
+
+    return results;
+}
+
+// name -> median of an earlier run
+static map<string, double> read_baseline(const char* path) {
+
+    map<string, double> baseline;
+    ifstream file(path);
+    string line;
+
+    while (getline(file, line)) {
+
+        istringstream is(line);
+        string name;
+        double median;
+
+        if (line[0] != '#' && is >> name >> median) {
+            baseline[name] = median;
+        }
+    }
+
+    return baseline;
+}
+
+int main(int argc, char* argv[]) {
+
+    const char* output = argc > 1 ? argv[1] : "bench.txt";
+    map<string, double> baseline;
+
+    if (argc > 2) {
+        baseline = read_baseline(argv[2]);
+
+        if (baseline.empty()) {
+            cerr << "no results in baseline file " << argv[2] << endl;
+            return 1;
+        }
+    }
+
+#ifdef BITBOARDS
+    const char* backend = "bitboards";
+#else
+    const char* backend = "mailbox";
+#endif
+
+    vector<BenchResult> results = run_benchmarks();
+
+    ofstream file(output);
+    file << "# name\tmedian ns/op\tp99 ns/op\tops/sample\t(" << backend << ")" << endl;
+
+    cout << left << fixed << setprecision(2) << setw(24) << "benchmark" << setw(14) << "median ns/op" << setw(14) << "p99 ns/op" << setw(12) << "ops/sample"
+         << (baseline.empty() ? "" : "median change") << endl;
+
+    for (const BenchResult& r : results) {
+
+        file << r.name << "\t" << fixed << setprecision(2) << r.median << "\t" << r.p99 << "\t" << r.ops << endl;
+
+        cout << setw(24) << r.name << setw(14) << r.median << setw(14) << r.p99 << setw(12) << r.ops;
+
+        if (baseline.count(r.name)) {
+            cout << showpos << (r.median / baseline[r.name] - 1) * 100 << noshowpos << " %";
+        }
+
+        cout << endl;
+    }
+
+    cout << "results written to " << output << " (" << backend << ")" << endl;
+}
@@ -0,0 +1,465 @@
+#include "bitbase.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+Bitbase bitbases[ENDGAME_NUM] = {Bitbase(KPK), Bitbase(KRK), Bitbase(KQK), Bitbase(KBNK)};
+
+// piece types of the stronger side besides the king
+static const Byte endgame_pieces[ENDGAME_NUM][2] = {{PAWN, 0}, {ROOK, 0}, {QUEEN, 0}, {BISHOP, KNIGHT}};
+
+const uint8_t COUNT_DRAW = 255;     // move count of a position with a move to a draw, it can't become a loss
+
+Bitbase::Bitbase(Endgame e) : endgame(e), extra_pieces(endgame_pieces[e][1] ? 2 : 1) {}
+
+// squares of a position (board64 order): white king, black king, pieces
+struct Placement {
+    int stm;
+    int squares[4];
+};
+
+static size_t encode(const Placement& p, int extra) {
+
+    size_t index = p.stm;
+
+    for (int i = 0; i < 2 + extra; i++) {
+        index = index * 64 + p.squares[i];
+    }
+
+    return index;
+}
+
+static Placement decode(size_t index, int extra) {
+
+    Placement p;
+
+    for (int i = 1 + extra; i >= 0; i--) {
+        p.squares[i] = index % 64;
+        index /= 64;
+    }
+
+    p.stm = index;
+
+    return p;
+}
+
+// set up the board of a placement (stronger side white), returns false if the squares can't form a position
+static bool setup(Board& b, const Placement& p, Endgame e, int extra) {
+
+    char placement[64];
+    memset(placement, 0, sizeof(placement));
+
+    const char letters[4] = {'K', 'k', piece2letter[(int)endgame_pieces[e][0]], piece2letter[(int)endgame_pieces[e][1]]};
+
+    for (int i = 0; i < 2 + extra; i++) {
+
+        if (placement[p.squares[i]]) {
+            return false;
+        }
+
+        placement[p.squares[i]] = letters[i];
+    }
+
+    char fen[96];
+    int n = 0;
+
+    for (int rank = 0; rank < 8; rank++) {
+
+        int empty = 0;
+
+        for (int file = 0; file < 8; file++) {
+
+            char c = placement[rank * 8 + file];
+
+            if (!c) {
+                empty++;
+                continue;
+            }
+
+            if (empty) {
+                fen[n++] = '0' + empty;
+                empty = 0;
+            }
+
+            fen[n++] = c;
+        }
+
+        if (empty) {
+            fen[n++] = '0' + empty;
+        }
+
+        fen[n++] = rank < 7 ? '/' : ' ';
+    }
+
+    fen[n++] = p.stm ? 'b' : 'w';
+    memcpy(fen + n, " - -", 4);
+
+    return b.set_fen(string_view(fen, n + 4)) == FEN_OK;
+}
+
+// placement of the board, with the side to play given
+static Placement placement_of(Board& b, Endgame e, int stm) {
+
+    Placement p;
+    p.stm = stm;
+    p.squares[0] = board120[b.squares(Piece{s_Byte(KING | WHITE)})[0]];
+    p.squares[1] = board120[b.squares(Piece{s_Byte(KING | BLACK)})[0]];
+
+    for (int i = 0; i < 2; i++) {
+        if (endgame_pieces[e][i]) {
+            p.squares[2 + i] = board120[b.squares(Piece{s_Byte(endgame_pieces[e][i] | WHITE)})[0]];
+        }
+    }
+
+    return p;
+}
+
+// result of the position after a capture or promotion (stronger side white), from the side to play's point of view
+static Wdl smaller_endgame(Board& b) {
+
+    int pieces = 0;
+
+    for (int val = PAWN; val <= QUEEN; val++) {
+        pieces += b.count(Piece{s_Byte(val)});
+    }
+
+    // a lone minor piece (or nothing) can't win
+    if (b.count(Piece{QUEEN}) == 0 && b.count(Piece{ROOK}) == 0 && pieces <= 1) {
+        return WDL_DRAW;
+    }
+
+    return probe_bitbase(b);
+}
+
+// run f(thread, begin, end) on all threads over [0, size) in chunks
+template<typename F>
+static void parallel_for(size_t size, int threads, F f) {
+
+    const size_t chunk = 4096;
+    atomic<size_t> next{0};
+    vector<thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+
+            for (size_t begin = next.fetch_add(chunk); begin < size; begin = next.fetch_add(chunk)) {
+                f(t, begin, min(begin + chunk, size));
+            }
+        });
+    }
+
+    for (thread& w : workers) {
+        w.join();
+    }
+}
+
+void Bitbase::generate(int threads) {
+
+    threads = max(threads, 1);
+
+    size_t size = positions();
+    int extra = extra_pieces;
+    Endgame e = endgame;
+
+    unique_ptr<atomic<uint8_t>[]> result(new atomic<uint8_t>[size]());     // WDL_DRAW until decided
+    unique_ptr<atomic<uint8_t>[]> count(new atomic<uint8_t>[size]());      // moves that are not decided yet
+
+    vector<vector<size_t>> found(threads);          // positions decided in the last step, per thread
+    vector<Board> boards(threads);
+
+    // 1. initial pass
+    parallel_for(size, threads, [&](int t, size_t begin, size_t end) {
+
+        Board& b = boards[t];
+        MoveList moves;
+
+        for (size_t i = begin; i < end; i++) {
+
+            Placement p = decode(i, extra);
+
+            // the side that just moved can't be in check
+            if (!setup(b, p, e, extra) || b.is_attacked(b.squares(Piece{s_Byte(KING | (p.stm ? WHITE : BLACK))})[0], p.stm ? WHITE : BLACK)) {
+                result[i] = WDL_INVALID;
+                continue;
+            }
+
+            b.generate_moves(moves);
+
+            if (moves.size == 0) {
+
+                if (b.in_check()) {
+                    result[i] = WDL_LOSS;
+                    found[t].push_back(i);
+                }
+
+                continue;       // stalemate is a draw
+            }
+
+            int counted = 0;
+            bool draw = false, win = false;
+
+            for (Move m : moves) {
+
+                if (m.captured.is_piece() || (m.flag >= KNIGHT_PROMO && m.flag <= QUEEN_PROMO)) {
+
+                    b.make_move(m, false);
+                    Wdl r = smaller_endgame(b);
+                    b.unmake_move(m);
+
+                    win |= r == WDL_LOSS;
+                    draw |= r == WDL_DRAW || r == WDL_UNKNOWN;
+                } else {
+                    counted++;
+                }
+            }
+
+            if (win) {
+                result[i] = WDL_WIN;
+                found[t].push_back(i);
+            } else if (draw) {
+                count[i] = COUNT_DRAW;
+            } else if (counted == 0) {
+                result[i] = WDL_LOSS;       // every move goes to a won smaller endgame
+                found[t].push_back(i);
+            } else {
+                count[i] = counted;
+            }
+        }
+    });
+
+    // 2. retrograde passes, one ply per pass
+    vector<size_t> frontier;
+
+    while (true) {
+
+        frontier.clear();
+        for (vector<size_t>& f : found) {
+            frontier.insert(frontier.end(), f.begin(), f.end());
+            f.clear();
+        }
+
+        if (frontier.empty()) {
+            break;
+        }
+
+        parallel_for(frontier.size(), threads, [&](int t, size_t begin, size_t end) {
+
+            Board& b = boards[t];
+            MoveList moves;
+
+            for (size_t k = begin; k < end; k++) {
+
+                size_t i = frontier[k];
+                Wdl r = Wdl(result[i].load());
+
+                // the same position with the other side to play, which makes the moves backwards
+                Placement p = decode(i, extra);
+                p.stm ^= 1;
+                setup(b, p, e, extra);
+
+                Byte mover = p.stm ? BLACK : WHITE;
+                Byte other_king_color = mover ^ BLACK;
+
+                moves.clear();
+
+                for (int type = PAWN; type <= KING; type++) {
+
+                    Piece piece = Piece{s_Byte(type | mover)};
+
+                    for (int n = 0; n < b.count(piece); n++) {
+
+                        Byte sq = b.squares(piece)[n];
+
+                        if (type == PAWN) {
+                            // white pawns came from behind, one square or two from the 2nd rank (not from the 1st)
+                            if (b.get(sq + 10) == EMPTY && sq + 10 < 91) {
+                                moves.push(Move(sq, sq + 10, EMPTY));
+
+                                if (sq >= 61 && sq <= 68 && b.get(sq + 20) == EMPTY) {
+                                    moves.push(Move(sq, sq + 20, EMPTY));
+                                }
+                            }
+                        } else {
+                            int first = moves.size;
+                            b.possible_moves(sq, moves);
+
+                            // captures and castling can't be made backwards
+                            int kept = first;
+                            for (int j = first; j < moves.size; j++) {
+                                if (!moves[j].captured.is_piece() && moves[j].flag == NO_FLAG) {
+                                    moves[kept++] = moves[j];
+                                }
+                            }
+                            moves.size = kept;
+                        }
+                    }
+                }
+
+                for (Move m : moves) {
+
+                    b.make_move(m, false);
+
+                    // in the predecessor the side that didn't move can't be in check
+                    Byte king = b.squares(Piece{s_Byte(KING | other_king_color)})[0];
+                    bool legal = !b.is_attacked(king, other_king_color);
+                    size_t pred = encode(placement_of(b, e, p.stm), extra);
+
+                    b.unmake_move(m);
+
+                    if (!legal || result[pred].load(memory_order_relaxed) != WDL_DRAW) {
+                        continue;
+                    }
+
+                    if (r == WDL_LOSS) {
+                        uint8_t expected = WDL_DRAW;
+                        if (result[pred].compare_exchange_strong(expected, WDL_WIN)) {
+                            found[t].push_back(pred);
+                        }
+                    } else if (count[pred].load(memory_order_relaxed) != COUNT_DRAW && count[pred].fetch_sub(1) == 1) {
+                        result[pred] = WDL_LOSS;
+                        found[t].push_back(pred);
+                    }
+                }
+            }
+        });
+    }
+
+    // 3. pack 2 bits per position, the rest stays a draw
+    bits.assign((size + 3) / 4, 0);
+
+    for (size_t i = 0; i < size; i++) {
+        bits[i / 4] |= result[i].load() << (i % 4 * 2);
+    }
+}
+
+bool Bitbase::write(FILE* f) {
+    return fwrite(bits.data(), 1, bits.size(), f) == bits.size();
+}
+
+bool Bitbase::read(FILE* f) {
+
+    bits.assign((positions() + 3) / 4, 0);
+
+    if (fread(bits.data(), 1, bits.size(), f) != bits.size()) {
+        bits.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void generate_bitbases(int threads, bool four_pieces) {
+
+    for (Endgame e : {KQK, KRK, KPK, KBNK}) {
+        if (e != KBNK || four_pieces) {
+            bitbases[e].generate(threads);
+        }
+    }
+}
+
+// file: "BITBASE1", a byte per endgame (1 -> included), then the bits of the included endgames in order
+bool save_bitbases(const char* path) {
+
+    FILE* f = fopen(path, "wb");
+
+    if (!f) {
+        return false;
+    }
+
+    bool ok = fwrite("BITBASE1", 1, 8, f) == 8;
+
+    for (Bitbase& bb : bitbases) {
+        ok = ok && fputc(bb.ready(), f) != EOF;
+    }
+
+    for (Bitbase& bb : bitbases) {
+        ok = ok && (!bb.ready() || bb.write(f));
+    }
+
+    return fclose(f) == 0 && ok;
+}
+
+bool load_bitbases(const char* path) {
+
+    FILE* f = fopen(path, "rb");
+
+    if (!f) {
+        return false;
+    }
+
+    char magic[8];
+    bool included[ENDGAME_NUM];
+    bool ok = fread(magic, 1, 8, f) == 8 && memcmp(magic, "BITBASE1", 8) == 0;
+
+    for (int e = 0; e < ENDGAME_NUM && ok; e++) {
+        int c = fgetc(f);
+        ok = c == 0 || c == 1;
+        included[e] = c == 1;
+    }
+
+    for (int e = 0; e < ENDGAME_NUM && ok; e++) {
+        ok = !included[e] || bitbases[e].read(f);
+    }
+
+    fclose(f);
+
+    return ok;
+}
+
+Wdl probe_bitbase(Board& b) {
+
+    int white = 0, black = 0;
+
+    for (int type = PAWN; type <= QUEEN; type++) {
+        white += b.count(Piece{s_Byte(type | WHITE)});
+        black += b.count(Piece{s_Byte(type | BLACK)});
+    }
+
+    if ((white && black) || white + black == 0 || white + black > 2) {
+        return WDL_UNKNOWN;
+    }
+
+    Byte strong = white ? WHITE : BLACK;
+
+    for (int e = 0; e < ENDGAME_NUM; e++) {
+
+        Bitbase& bb = bitbases[e];
+
+        if (!bb.ready() || bb.extra_pieces != white + black) {
+            continue;
+        }
+
+        // the pieces must be the ones of this endgame
+        bool match = true;
+
+        for (int i = 0; i < bb.extra_pieces; i++) {
+            match &= b.count(Piece{s_Byte(endgame_pieces[e][i] | strong)}) == 1;
+        }
+
+        if (!match) {
+            continue;
+        }
+
+        // squares with the stronger side as white, black pieces are mirrored to the other side of the board
+        int flip = strong ? 56 : 0;
+
+        Placement p;
+        p.stm = b.get_turn() != (strong == BLACK);
+        p.squares[0] = board120[b.squares(Piece{s_Byte(KING | strong)})[0]] ^ flip;
+        p.squares[1] = board120[b.squares(Piece{s_Byte(KING | (strong ^ BLACK))})[0]] ^ flip;
+
+        for (int i = 0; i < bb.extra_pieces; i++) {
+            p.squares[2 + i] = board120[b.squares(Piece{s_Byte(endgame_pieces[e][i] | strong)})[0]] ^ flip;
+        }
+
+        Wdl r = bb.get(encode(p, bb.extra_pieces));
+
+        return r == WDL_INVALID ? WDL_UNKNOWN : r;
+    }
+
+    return WDL_UNKNOWN;
+}
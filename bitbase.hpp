@@ -0,0 +1,74 @@
+#ifndef BITBASE_H
+#define BITBASE_H
+
+#include "board.hpp"
+#include <cstdint>
+#include <vector>
+
+/*  bitbases: win/draw/loss of every position of a small endgame (king and one or two pieces against a lone king),
+    2 bits per position, generated by retrograde analysis with the move generator of Board.
+
+    1. every position is set up once: mates are losses, stalemates and moves to a drawn smaller endgame
+       (the lone king captures a piece) are draws, a promotion to a won KQK/KRK position is a win,
+       and the other moves are counted.
+    2. starting from the decided positions, the predecessors are found by making the moves of the side that
+       just moved backwards (make_move / unmake_move of a non capture, pawns one or two squares back).
+       a predecessor of a loss is a win, and a predecessor is a loss when all its counted moves lead to wins.
+    3. everything that is left is a draw.
+    both passes run on several threads. see https://www.chessprogramming.org/Retrograde_Analysis
+
+    positions are stored with the stronger side as white and indexed by
+    (side to play, white king, black king, piece 1, piece 2), squares in board64 order,
+    side to play 0 -> stronger side, 1 -> lone king.
+*/
+
+enum Wdl : uint8_t {
+    WDL_DRAW,
+    WDL_WIN,            // for the side to play
+    WDL_LOSS,
+    WDL_INVALID,        // not a legal position
+    WDL_UNKNOWN         // not in a bitbase (probe only)
+};
+
+enum Endgame {
+    KPK,
+    KRK,
+    KQK,
+    KBNK,
+    ENDGAME_NUM
+};
+
+const char* const endgame_str[] = {"KPK", "KRK", "KQK", "KBNK"};
+
+class Bitbase {
+    private:
+        vector<uint8_t> bits;       // 4 positions per byte
+    public:
+        Endgame endgame;
+        int extra_pieces;           // pieces besides the kings
+
+        explicit Bitbase(Endgame e);
+
+        size_t positions() { return size_t(2) << (6 * (2 + extra_pieces)); }
+        bool ready() { return !bits.empty(); }
+
+        Wdl get(size_t index) { return Wdl(bits[index / 4] >> (index % 4 * 2) & 3); }
+
+        void generate(int threads);
+        bool write(FILE* f);
+        bool read(FILE* f);
+};
+
+extern Bitbase bitbases[ENDGAME_NUM];
+
+// generate all bitbases (KQK and KRK first, KPK needs them for promotions)
+void generate_bitbases(int threads, bool four_pieces = true);
+
+// write / read all generated bitbases to / from a file
+bool save_bitbases(const char* path);
+bool load_bitbases(const char* path);
+
+// result of the position from the side to play's point of view, WDL_UNKNOWN if it isn't in a generated bitbase
+Wdl probe_bitbase(Board& b);
+
+#endif //BITBASE_H
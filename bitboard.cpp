@@ -0,0 +1,186 @@
+#include "bitboard.hpp"
+
+Bitboard knight_attacks[64];
+Bitboard king_attacks[64];
+Bitboard pawn_attacks[2][64];
+
+Bitboard between_bb[64][64];
+Bitboard line_bb[64][64];
+
+Magic bishop_magics[64];
+Magic rook_magics[64];
+
+static Bitboard bishop_table[0x1480];   // sum of 2^(relevant bits) over all squares
+static Bitboard rook_table[0x19000];
+
+static const int bishop_dirs[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};    // {rank step, file step}
+static const int rook_dirs[4][2] = {{-1, 0}, {0, -1}, {0, 1}, {1, 0}};
+
+
+static bool on_board(int row, int file) {
+    return row >= 0 && row < 8 && file >= 0 && file < 8;
+}
+
+// attacks of a slider on given square, stepping each direction until the edge or the first occupied square
+static Bitboard sliding_attacks(int square, Bitboard occupied, const int dirs[4][2]) {
+
+    Bitboard attacks = 0;
+
+    for (int i = 0; i < 4; i++) {
+
+        int row = square / 8 + dirs[i][0];
+        int file = square % 8 + dirs[i][1];
+
+        while (on_board(row, file)) {
+
+            attacks |= square_bb(row * 8 + file);
+
+            if (occupied & square_bb(row * 8 + file)) {
+                break;
+            }
+
+            row += dirs[i][0];
+            file += dirs[i][1];
+        }
+    }
+
+    return attacks;
+}
+
+// attacks of a non sliding piece given by a list of {rank step, file step} pairs
+static Bitboard leaper_attacks(int square, const int steps[][2], int num) {
+
+    Bitboard attacks = 0;
+
+    for (int i = 0; i < num; i++) {
+
+        int row = square / 8 + steps[i][0];
+        int file = square % 8 + steps[i][1];
+
+        if (on_board(row, file)) {
+            attacks |= square_bb(row * 8 + file);
+        }
+    }
+
+    return attacks;
+}
+
+#ifndef USE_PEXT
+// xorshift64* pseudo random numbers, fixed seed so the magics are the same every run
+static uint64_t rand64() {
+
+    static uint64_t s = 1070372;
+
+    s ^= s >> 12;
+    s ^= s << 25;
+    s ^= s >> 27;
+
+    return s * 2685821657736338717ULL;
+}
+#endif
+
+// fill the magic entries and attack table for one slider type
+static void init_magics(Magic magics[64], Bitboard* table, const int dirs[4][2]) {
+
+    Bitboard occupancy[4096], reference[4096];
+#ifndef USE_PEXT
+    int epoch[4096] = {0};
+    int attempt = 0;
+#endif
+
+    for (int sq = 0; sq < 64; sq++) {
+
+        // squares on the edge never block, unless the slider is on that edge itself
+        Bitboard edges = ((RANK_1 | RANK_8) & ~(RANK_8 << (sq / 8 * 8))) | ((FILE_A | FILE_H) & ~(FILE_A << (sq % 8)));
+
+        Magic& m = magics[sq];
+        m.mask = sliding_attacks(sq, 0, dirs) & ~edges;
+        m.shift = 64 - popcount(m.mask);
+        m.attacks = table;
+
+        // enumerate all subsets of the mask (carry rippler) with their attack sets
+        int size = 0;
+        Bitboard b = 0;
+
+        do {
+            occupancy[size] = b;
+            reference[size] = sliding_attacks(sq, b, dirs);
+            size++;
+            b = (b - m.mask) & m.mask;
+        } while (b);
+
+        table += size;
+
+#ifdef USE_PEXT
+        for (int i = 0; i < size; i++) {
+            m.attacks[m.index(occupancy[i])] = reference[i];
+        }
+#else
+        // try sparse random numbers until one maps every occupancy to a slot without destructive collisions
+        for (int i = 0; i < size; ) {
+
+            m.magic = 0;
+            while (popcount((m.mask * m.magic) >> 56) < 6) {
+                m.magic = rand64() & rand64() & rand64();
+            }
+
+            attempt++;
+
+            for (i = 0; i < size; i++) {
+
+                unsigned idx = m.index(occupancy[i]);
+
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+#endif
+    }
+}
+
+void init_bitboards() {
+
+    const int knight_steps[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+    const int king_steps[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+    const int pawn_steps[2][2][2] = {{{-1, -1}, {-1, 1}}, {{1, -1}, {1, 1}}};     // white pawns move to lower rows
+
+    for (int sq = 0; sq < 64; sq++) {
+        knight_attacks[sq] = leaper_attacks(sq, knight_steps, 8);
+        king_attacks[sq] = leaper_attacks(sq, king_steps, 8);
+        pawn_attacks[0][sq] = leaper_attacks(sq, pawn_steps[0], 2);
+        pawn_attacks[1][sq] = leaper_attacks(sq, pawn_steps[1], 2);
+    }
+
+    // lines and squares in between, walking from every square in the 8 directions
+    for (int sq = 0; sq < 64; sq++) {
+        for (int i = 0; i < 8; i++) {
+
+            const int* dir = king_steps[i];
+            Bitboard line = square_bb(sq);
+
+            for (int step = -7; step <= 7; step++) {
+                int row = sq / 8 + dir[0] * step;
+                int file = sq % 8 + dir[1] * step;
+
+                if (on_board(row, file)) {
+                    line |= square_bb(row * 8 + file);
+                }
+            }
+
+            Bitboard between = 0;
+
+            for (int row = sq / 8 + dir[0], file = sq % 8 + dir[1]; on_board(row, file); row += dir[0], file += dir[1]) {
+                between_bb[sq][row * 8 + file] = between;
+                line_bb[sq][row * 8 + file] = line;
+                between |= square_bb(row * 8 + file);
+            }
+        }
+    }
+
+    init_magics(bishop_magics, bishop_table, bishop_dirs);
+    init_magics(rook_magics, rook_table, rook_dirs);
+}
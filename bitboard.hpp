@@ -0,0 +1,84 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+/*  bitboards are 64 bit sets of squares, used by the bitboard backend of Board (compile with -DBITBOARDS).
+    bit i is square i of the 8x8 board in the same order as board64 (a8 = 0, h8 = 7, ..., h1 = 63),
+    so board120[square] gives the bit index of a 10x12 board square and board64[bit] the other way around.
+
+    sliding attacks (bishop, rook, queen) are looked up with magic bitboards,
+    or with the BMI2 pext instruction when compiled with -DUSE_PEXT -mbmi2.
+    see https://www.chessprogramming.org/Magic_Bitboards
+*/
+
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
+typedef uint64_t Bitboard;
+
+const Bitboard RANK_8 = 0xFFULL;
+const Bitboard RANK_7 = 0xFFULL << 8;
+const Bitboard RANK_6 = 0xFFULL << 16;
+const Bitboard RANK_3 = 0xFFULL << 40;
+const Bitboard RANK_2 = 0xFFULL << 48;
+const Bitboard RANK_1 = 0xFFULL << 56;
+
+const Bitboard FILE_A = 0x0101010101010101ULL;
+const Bitboard FILE_H = FILE_A << 7;
+
+struct Magic {
+    Bitboard mask;          // relevant occupancy (ray squares without the edge)
+    Bitboard magic;
+    Bitboard* attacks;      // attack sets of this square, indexed by hashed occupancy
+    int shift;
+
+    unsigned index(Bitboard occupied) const {
+#ifdef USE_PEXT
+        return _pext_u64(occupied, mask);
+#else
+        return ((occupied & mask) * magic) >> shift;
+#endif
+    }
+};
+
+extern Bitboard knight_attacks[64];
+extern Bitboard king_attacks[64];
+extern Bitboard pawn_attacks[2][64];    // squares attacked by a [white, black] pawn
+
+extern Bitboard between_bb[64][64];     // squares strictly between two squares on the same line, 0 if not on a line
+extern Bitboard line_bb[64][64];        // the whole line (edge to edge) through two squares, 0 if not on a line
+
+extern Magic bishop_magics[64];
+extern Magic rook_magics[64];
+
+void init_bitboards();
+
+inline Bitboard square_bb(int square) { return 1ULL << square; }
+
+inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+
+inline int pop_lsb(Bitboard& b) {
+    int square = lsb(b);
+    b &= b - 1;
+    return square;
+}
+
+inline int popcount(Bitboard b) { return __builtin_popcountll(b); }
+
+inline Bitboard bishop_attacks(int square, Bitboard occupied) {
+    const Magic& m = bishop_magics[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard rook_attacks(int square, Bitboard occupied) {
+    const Magic& m = rook_magics[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard queen_attacks(int square, Bitboard occupied) {
+    return bishop_attacks(square, occupied) | rook_attacks(square, occupied);
+}
+
+#endif //BITBOARD_H
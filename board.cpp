@@ -1,335 +1,1489 @@
-#include "Board.hpp"
+#include "board.hpp"
+#include "eval.hpp"
+#include "stats.hpp"
 #include <assert.h>
+#include <cstdio>
 
 using namespace std;
 
-// set up board with given FEN string
-Board::Board(string fen) {
+// set up board with given FEN string, which must be valid (use set_fen for input that isn't)
+Board::Board(string_view fen) {
 
-    // split FEN string in 6 fields
+#ifdef BITBOARDS
+    [[maybe_unused]] static const bool bitboards_ready = (init_bitboards(), true);
+#endif
 
-    string fensplit[6];
+    FenError error = set_fen(fen);
+    assert(error == FEN_OK);
+    (void)error;
+}
+
+// parse a non negative number of at most 4 digits at position i of s
+static bool parse_number(string_view s, size_t& i, int& number) {
+
+    size_t start = i;
+    number = 0;
+
+    while (i < s.size() && isdigit(s[i]) && i - start < 4) {
+        number = number * 10 + s[i++] - '0';
+    }
+
+    return i > start && (i == s.size() || s[i] == ' ');
+}
+
+// empty board, without castling rights and en passant square
+void Board::clear() {
+
+    for (int i = 0; i < 120; i++) {
+        board[i] = OUTSIDE_BOARD;
+    }
+
+    for (int i = 0; i < 64; i++) {
+        board[board64[i]] = EMPTY;
+    }
+
+    for (int i = 0; i < 15; i++) {
+        piece_num[i] = 0;
+    }
+
+#ifdef BITBOARDS
+    for (int i = 0; i < 15; i++) {
+        pieces[i] = 0;
+    }
+    colors[0] = colors[1] = 0;
+#endif
+
+    psqt_score = Score{};
+    phase = 0;
+    kings[0] = kings[1] = 0;
+    castle_rights = 0;
+    en_pass_sq = 0;
+    halfmove = 0;
+    fullmove = 1;
+    ply = 0;
+}
+
+// set up board with given FEN string, without allocating
+// the move counters are optional, so the first 4 fields of an EPD line are read as well (the rest is ignored)
+// on error the board is left in an unusable state
+FenError Board::set_fen(string_view fen) {
+
+    clear();
+
+    size_t i = 0;
+    auto at = [&](size_t k) { return k < fen.size() ? fen[k] : '\0'; };
+    auto next_field = [&]() {
+        bool space = at(i) == ' ';
+        while (at(i) == ' ') {
+            i++;
+        }
+        return space;
+    };
+
+    // piece placement, from a8 to h1
+    int rank = 0, file = 0;
+
+    for (; i < fen.size() && fen[i] != ' '; i++) {
+
+        char c = fen[i];
+
+        if (c == '/') {
+
+            if (file != 8 || ++rank > 7) {
+                return FEN_BAD_PLACEMENT;
+            }
+
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+
+            if ((file += c - '0') > 8) {
+                return FEN_BAD_PLACEMENT;
+            }
+        } else {
+
+            Piece p = letter2piece[c];
+
+            if (!p.is_piece() || file > 7 || (p.type() == PAWN && (rank == 0 || rank == 7))) {
+                return FEN_BAD_PLACEMENT;
+            }
+
+            Byte sq = board64[rank * 8 + file];
+
+            if (p.type() == KING) {
+
+                if (piece_num[p.val]) {
+                    return FEN_BAD_KINGS;
+                }
+
+                kings[p.color()/8] = sq;
+            }
+
+            if (!has_room(p)) {
+                return FEN_BAD_PLACEMENT;
+            }
+
+            put_piece(sq, p);
+            file++;
+        }
+    }
+
+    if (rank != 7 || file != 8) {
+        return FEN_BAD_PLACEMENT;
+    }
+
+    if (!kings[0] || !kings[1]) {
+        return FEN_BAD_KINGS;
+    }
+
+    // active color
+    if (!next_field() || (at(i) != 'w' && at(i) != 'b') || (at(i + 1) != ' ' && at(i + 1) != '\0')) {
+        return FEN_BAD_SIDE;
+    }
+
+    turn = at(i++) == 'b';
+
+    // castling rights, the king and rook must be on their starting squares
+    if (!next_field()) {
+        return FEN_BAD_CASTLING;
+    }
+
+    if (at(i) == '-') {
+        i++;
+    } else {
+
+        for (; at(i) && at(i) != ' '; i++) {
+
+            Piece p = letter2piece[at(i)];
+
+            if (p.type() != KING && p.type() != QUEEN) {
+                return FEN_BAD_CASTLING;
+            }
+
+            Byte right = 1 << (p.color()/4 + (p.val & 1));
+            Byte king = p.color() ? 25 : 95;
+            Byte rook = p.type() == KING ? king + 3 : king - 4;
+
+            if (board[king] != Piece{s_Byte(KING | p.color())} || board[rook] != Piece{s_Byte(ROOK | p.color())}) {
+                return FEN_BAD_CASTLING;
+            }
+
+            castle_rights |= right;
+        }
+    }
+
+    // en passant target square, behind a pawn of the side that just moved
+    if (!next_field()) {
+        return FEN_BAD_EN_PASSANT;
+    }
+
+    if (at(i) == '-') {
+        i++;
+    } else {
+
+        char f = at(i), r = at(i + 1);
+
+        if (f < 'a' || f > 'h' || r != (turn ? '3' : '6')) {
+            return FEN_BAD_EN_PASSANT;
+        }
+
+        en_pass_sq = algebraic2int(f, r);
+        i += 2;
+
+        if (board[en_pass_sq + (turn ? -10 : 10)] != Piece{s_Byte(PAWN | (turn ? WHITE : BLACK))}) {
+            return FEN_BAD_EN_PASSANT;
+        }
+    }
+
+    if (at(i) && at(i) != ' ') {
+        return FEN_BAD_EN_PASSANT;
+    }
+
+    // halfmove clock and fullmove number, optional
+    int number;
+
+    if (next_field() && isdigit(at(i))) {
+
+        if (!parse_number(fen, i, number) || number > MAX_HALFMOVE) {
+            return FEN_BAD_CLOCK;
+        }
+
+        halfmove = number;
+
+        if (next_field() && isdigit(at(i))) {
+
+            if (!parse_number(fen, i, number) || number == 0) {
+                return FEN_BAD_CLOCK;
+            }
+
+            fullmove = number;
+        }
+    }
+
+    key = compute_key();
+
+    return FEN_OK;
+}
+
+// FEN string of the position
+string Board::to_fen() {
+
+    char fen[96];       // longest FEN is about 90 characters
+    int n = 0;
+
+    for (int rank = 0; rank < 8; rank++) {
+
+        int empty = 0;
+
+        for (int file = 0; file < 8; file++) {
+
+            Piece p = board[board64[rank * 8 + file]];
+
+            if (p == EMPTY) {
+                empty++;
+                continue;
+            }
+
+            if (empty) {
+                fen[n++] = '0' + empty;
+                empty = 0;
+            }
+
+            fen[n++] = piece2letter[p.val];
+        }
+
+        if (empty) {
+            fen[n++] = '0' + empty;
+        }
+
+        fen[n++] = rank < 7 ? '/' : ' ';
+    }
+
+    fen[n++] = turn ? 'b' : 'w';
+    fen[n++] = ' ';
+
+    if (!castle_rights) {
+        fen[n++] = '-';
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (castle_rights & (1 << i)) {
+            fen[n++] = piece2letter[6 + (i/2)*8 - i%2];
+        }
+    }
+
+    fen[n++] = ' ';
+
+    if (en_pass_sq) {
+        fen[n++] = 'a' + board120[en_pass_sq] % 8;
+        fen[n++] = '8' - board120[en_pass_sq] / 8;
+    } else {
+        fen[n++] = '-';
+    }
+
+    n += snprintf(fen + n, sizeof(fen) - n, " %d %d", halfmove, fullmove);
+
+    return string(fen, n);
+}
+
+// set up board with a packed position, checked like a FEN string
+// on error the board is left in an unusable state
+FenError Board::set_packed(const PackedPosition& packed) {
+
+    clear();
+
+    Bitboard occupied = 0;
+
+    for (int i = 0; i < 8; i++) {
+        occupied |= Bitboard(packed.occupancy[i]) << (i * 8);
+    }
+
+    if (popcount(occupied) > 32) {
+        return FEN_BAD_PLACEMENT;
+    }
+
+    // the key is computed on the way, not with compute_key
+    key = 0;
+
+    for (int n = 0; occupied; n++) {
+
+        int i = pop_lsb(occupied);
+        Piece p{s_Byte(packed.pieces[n / 2] >> (n % 2 * 4) & 15)};
+
+        if (p.type() < PAWN || p.type() > KING || (p.type() == PAWN && (i < 8 || i >= 56))) {
+            return FEN_BAD_PLACEMENT;
+        }
+
+        Byte sq = board64[i];
+
+        if (p.type() == KING) {
+
+            if (piece_num[p.val]) {
+                return FEN_BAD_KINGS;
+            }
+
+            kings[p.color()/8] = sq;
+        }
+
+        if (!has_room(p)) {
+            return FEN_BAD_PLACEMENT;
+        }
+
+        put_piece(sq, p);
+        key ^= zobrist.pieces[p.val][i];
+    }
+
+    if (!kings[0] || !kings[1]) {
+        return FEN_BAD_KINGS;
+    }
+
+    turn = packed.turn_fullmove[1] >> 7;
+    halfmove = packed.halfmove;
+
+    if (halfmove > MAX_HALFMOVE) {
+        return FEN_BAD_CLOCK;
+    }
+
+    castle_rights = packed.castle_en_pass & 15;
+
+    // the king and rook of every castling right must be on their starting squares
+    for (int i = 0; i < 4; i++) {
+
+        Byte color = i < 2 ? WHITE : BLACK;
+        Byte king = color ? 25 : 95;
+        Byte rook = i % 2 ? king - 4 : king + 3;
+
+        if ((castle_rights & (1 << i)) && (board[king] != Piece{s_Byte(KING | color)} || board[rook] != Piece{s_Byte(ROOK | color)})) {
+            return FEN_BAD_CASTLING;
+        }
+    }
+
+    int file = packed.castle_en_pass >> 4;
+
+    if (file) {
+
+        if (file > 8) {
+            return FEN_BAD_EN_PASSANT;
+        }
+
+        en_pass_sq = algebraic2int('a' + file - 1, turn ? '3' : '6');
+
+        if (board[en_pass_sq + (turn ? -10 : 10)] != Piece{s_Byte(PAWN | (turn ? WHITE : BLACK))}) {
+            return FEN_BAD_EN_PASSANT;
+        }
+    }
+
+    fullmove = packed.turn_fullmove[0] | (packed.turn_fullmove[1] & 127) << 8;
+
+    if (fullmove == 0) {
+        return FEN_BAD_CLOCK;
+    }
+
+    key ^= zobrist.castling[castle_rights];
+
+    if (en_pass_sq) {
+        key ^= zobrist.en_passant[file - 1];
+    }
+
+    if (turn) {
+        key ^= zobrist.side;
+    }
+
+    return FEN_OK;
+}
+
+// packed position, returns false if there are more than 32 pieces or the move counters don't fit
+// (halfmove clock above MAX_HALFMOVE after moves made on the board, fullmove number above 32767)
+bool Board::to_packed(PackedPosition& packed) {
+
+    if (halfmove > MAX_HALFMOVE || fullmove > 32767) {
+        return false;
+    }
+
+    packed = PackedPosition{};
+    int n = 0;
+
+    for (int i = 0; i < 64; i++) {
+
+        Piece p = board[board64[i]];
+
+        if (p == EMPTY) {
+            continue;
+        }
+
+        if (n == 32) {
+            return false;
+        }
+
+        packed.occupancy[i / 8] |= 1 << (i % 8);
+        packed.pieces[n / 2] |= p.val << (n % 2 * 4);
+        n++;
+    }
+
+    packed.halfmove = halfmove;
+    packed.castle_en_pass = castle_rights | (en_pass_sq ? board120[en_pass_sq] % 8 + 1 : 0) << 4;
+    packed.turn_fullmove[0] = fullmove & 255;
+    packed.turn_fullmove[1] = turn << 7 | fullmove >> 8;
+
+    return true;
+}
+
+// piece can be added without going over the piece list size or the pieces a color can have (8 pawns, 16 in all)
+bool Board::has_room(Piece piece) {
+
+    int total = 0;
+
+    for (int type = PAWN; type <= KING; type++) {
+        total += piece_num[type | piece.color()];
+    }
+
+    return piece_num[piece.val] < MAX_PIECES && (piece.type() != PAWN || piece_num[piece.val] < 8) && total < 16;
+}
+
+// place piece on empty square
+inline void Board::put_piece(Byte square, Piece piece) {
+
+    board[square] = piece;
+
+    psqt_score += psqt.scores[piece.val][board120[square]];
+    phase += phase_value[piece.type()];
+
+    list_index[square] = piece_num[piece.val];
+    piece_list[piece.val][piece_num[piece.val]++] = square;
+
+#ifdef BITBOARDS
+    Bitboard b = square_bb(board120[square]);
+    pieces[piece.val] |= b;
+    colors[piece.color()/8] |= b;
+#endif
+}
+
+// remove piece from square
+inline void Board::remove_piece(Byte square) {
+
+    Piece piece = board[square];
+
+    psqt_score -= psqt.scores[piece.val][board120[square]];
+    phase -= phase_value[piece.type()];
+
+    // move the last piece of the list into the hole
+    Byte last = piece_list[piece.val][--piece_num[piece.val]];
+    piece_list[piece.val][list_index[square]] = last;
+    list_index[last] = list_index[square];
+
+#ifdef BITBOARDS
+    Bitboard b = square_bb(board120[square]);
+    pieces[piece.val] ^= b;
+    colors[piece.color()/8] ^= b;
+#endif
+
+    board[square] = EMPTY;
+}
+
+// get piece on given square
+Piece Board::get(Byte square) {
+    return board[square];
+}
+
+// get number of pieces of given type and color
+int Board::count(Piece piece) {
+    return piece_num[piece.val];
+}
+
+// get squares of all pieces of given type and color (count(piece) squares, in no particular order)
+const Byte* Board::squares(Piece piece) {
+    return piece_list[piece.val];
+}
+
+// get side to play (0 -> white, 1 -> black)
+bool Board::get_turn() {
+    return turn;
+}
+
+// get halfmove clock (plies since the last capture or pawn move)
+int Board::get_halfmove() {
+    return halfmove;
+}
+
+// get castling rights bits (WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO)
+Byte Board::get_castle_rights() {
+    return castle_rights;
+}
+
+// get en passant target square, 0 if there is none
+Byte Board::get_en_pass_sq() {
+    return en_pass_sq;
+}
+
+// check if the king of the side to play is attacked
+bool Board::in_check() {
+    return is_attacked(kings[turn], turn ? BLACK : WHITE);
+}
+
+// get zobrist key of the position
+uint64_t Board::get_key() {
+    return key;
+}
+
+// compute zobrist key of the position from scratch (make_move updates it incrementally)
+uint64_t Board::compute_key() {
+
+    uint64_t k = 0;
+
+    for (int sq = 0; sq < 64; sq++) {
+        Piece p = board[board64[sq]];
+
+        if (p.is_piece()) {
+            k ^= zobrist.pieces[p.val][sq];
+        }
+    }
+
+    k ^= zobrist.castling[castle_rights];
+
+    if (en_pass_sq) {
+        k ^= zobrist.en_passant[board120[en_pass_sq] % 8];
+    }
+
+    if (turn) {
+        k ^= zobrist.side;
+    }
+
+    return k;
+}
+
+// get sum of the piece-square values (middlegame and endgame) of all pieces
+Score Board::get_psqt() {
+    return psqt_score;
+}
+
+// compute sum of the piece-square values from scratch (put_piece and remove_piece update it incrementally)
+Score Board::compute_psqt() {
+
+    Score s;
+
+    for (int sq = 0; sq < 64; sq++) {
+        Piece p = board[board64[sq]];
+
+        if (p.is_piece()) {
+            s += psqt.scores[p.val][sq];
+        }
+    }
+
+    return s;
+}
+
+// get game phase, MAX_PHASE (or more after promotions) at the start, 0 with only kings and pawns
+int Board::get_phase() {
+    return phase;
+}
+
+// check if the position occurred (at least) given number of times before
+// only positions since the last capture or pawn move (halfmove clock) can be equal
+bool Board::is_repetition(int times) {
+
+    int end = max(ply - halfmove, 0);
+
+    for (int i = ply - 4; i >= end; i -= 2) {     // a position can't repeat within 4 plies
+        if (history[i].key == key && --times == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// move piece from start square to end square
+// if the move is legal, returns true (moves from generate_moves are always legal, so the check can be skipped)
+bool Board::make_move(Move m, bool check_legal) {
+    assert(m.start >= 0 && m.start < 120 && m.end >= 0 && m.end < 120);
+    assert(board[m.start] != OUTSIDE_BOARD && board[m.end] != OUTSIDE_BOARD);
+
+    STAT_INC(STAT_MAKE_MOVE);
+    STAT_TIMER(TIMER_MAKE_MOVE);
+
+    assert(ply < MAX_HISTORY);
+
+    // save irreversible state
+    history[ply++] = State{key, en_pass_sq, castle_rights, halfmove};
+
+    Piece piece = board[m.start];
+    bool pawn_move = piece.type() == PAWN;
+
+    key ^= zobrist.side ^ zobrist.pieces[piece.val][board120[m.start]];
+
+    if (en_pass_sq) {
+        key ^= zobrist.en_passant[board120[en_pass_sq] % 8];
+        en_pass_sq = 0;
+    }
+    
+    // check flag
+    switch (m.flag) {
+
+        case EN_PASSANT: {
+            Byte en_pass_capt = m.start > m.end ? m.end + 10 : m.end - 10;
+            key ^= zobrist.pieces[board[en_pass_capt].val][board120[en_pass_capt]];
+            remove_piece(en_pass_capt);
+            break;
+        }
+        
+        case KNIGHT_PROMO:
+        case BISHOP_PROMO:
+        case ROOK_PROMO:
+        case QUEEN_PROMO: {
+            piece = Piece{s_Byte(m.flag | piece.color())};
+            break;
+        }
+
+        case CASTLES: {
+            Byte rook_start = 21 + 70*(!piece.color()) + 7*(m.start < m.end);
+            Byte rook_end = 24 + 70*(!piece.color()) + 2*(m.start < m.end);
+
+            Piece rook = board[rook_start];
+            key ^= zobrist.pieces[rook.val][board120[rook_start]] ^ zobrist.pieces[rook.val][board120[rook_end]];
+            put_piece(rook_end, rook);
+            remove_piece(rook_start);
+            break;
+        }
+
+        case TWO_FORWARD: {
+            en_pass_sq = (m.start + m.end)/2;
+            key ^= zobrist.en_passant[board120[en_pass_sq] % 8];
+            break;
+        }
+    }
+
+    // move piece
+    if (m.captured.is_piece()) {
+        key ^= zobrist.pieces[m.captured.val][board120[m.end]];
+        remove_piece(m.end);
+    }
+    remove_piece(m.start);
+    put_piece(m.end, piece);
+    key ^= zobrist.pieces[piece.val][board120[m.end]];
+
+    // update king position if changed
+    if (piece.type() == KING) {
+        kings[piece.color()/8] = m.end;
+    }
+
+    // remove castling rights if king or rook moved or rook was captured
+    key ^= zobrist.castling[castle_rights];
+    castle_rights &= castle_mask[m.start] & castle_mask[m.end];
+    key ^= zobrist.castling[castle_rights];
+
+    // update fullmove, the counter updates after black moves
+    fullmove += turn;
+
+    // update halfmove, the counter is reset after captures or pawn moves, and incremented otherwise
+    if (m.captured != EMPTY || pawn_move) {
+        halfmove = 0;
+    } else {
+        halfmove++;
+    }
+
+    // update turn
+    turn = !turn;
+
+    if (!check_legal) {
+        return true;
+    }
+
+    // check if move was legal
+    int castled = (m.flag == CASTLES) * (m.start - m.end)/2;
+    bool legal = move_was_legal(piece.color(), castled);
+
+    if (!legal) {
+        STAT_INC(STAT_ILLEGAL_MOVES);
+    }
+
+    return legal;
+}
+
+// unmake last move made
+void Board::unmake_move(Move m) {
+    assert(m.start >= 0 && m.start < 120 && m.end >= 0 && m.end < 120);
+    assert(board[m.start] != OUTSIDE_BOARD && board[m.end] != OUTSIDE_BOARD);
+    assert(ply > 0);
+
+    STAT_INC(STAT_UNMAKE_MOVE);
+    STAT_TIMER(TIMER_UNMAKE_MOVE);
+
+    Piece piece = board[m.end];
+
+    // check flag
+    switch (m.flag) {
+
+        case EN_PASSANT: {
+            Byte en_pass_capt = m.start > m.end ? m.end + 10 : m.end - 10;
+            put_piece(en_pass_capt, Piece{s_Byte(PAWN | !piece.color() * 8)});
+            break;
+        }
+        
+        case KNIGHT_PROMO:
+        case BISHOP_PROMO:
+        case ROOK_PROMO:
+        case QUEEN_PROMO: {
+            piece = Piece{s_Byte(PAWN | piece.color())};
+            break;
+        }
+
+        case CASTLES: {
+            Byte rook_start = 21 + 70*(!piece.color()) + 7*(m.start < m.end);
+            Byte rook_end = 24 + 70*(!piece.color()) + 2*(m.start < m.end);
+
+            put_piece(rook_start, board[rook_end]);
+            remove_piece(rook_end);
+            break;
+        }
+    }
+
+    // move piece
+    remove_piece(m.end);
+    put_piece(m.start, piece);
+    if (m.captured.is_piece()) {
+        put_piece(m.end, m.captured);
+    }
+
+    // update king position if changed
+    if (piece.type() == KING) {
+        kings[piece.color()/8] = m.start;
+    }
+
+    // update turn
+    turn = !turn;
+
+    // update fullmove, the counter updates after black moves
+    fullmove -= turn;
+
+    // restore irreversible state
+    State& state = history[--ply];
+    key = state.key;
+    en_pass_sq = state.en_pass_sq;
+    halfmove = state.halfmove;
+    castle_rights = state.castle_rights;
+}
+
+
+// check if last move made was legal
+bool Board::move_was_legal(Byte color, int castled) {   // castled = 0 -> didnt castle, castled = 1 -> castled kingside, castled = -1 -> castled queenside
+
+    STAT_INC(STAT_MOVE_WAS_LEGAL);
+
+    Byte kingpos = kings[color/8];
+
+    if (castled) {  // last move was castling
+        return !is_attacked(kingpos, color) && !is_attacked(kingpos + castled, color) && !is_attacked(kingpos + castled*2, color);
+    } else {
+        return !is_attacked(kingpos, color);
+    }
+}
+
+#ifdef BITBOARDS
+
+// pieces of given color attacking square, with given occupancy
+inline Bitboard Board::attackers(int square, Bitboard occupied, Byte color) {
+
+    return (pawn_attacks[!(color/8)][square] & pieces[PAWN | color])
+        | (knight_attacks[square] & pieces[KNIGHT | color])
+        | (king_attacks[square] & pieces[KING | color])
+        | (bishop_attacks(square, occupied) & (pieces[BISHOP | color] | pieces[QUEEN | color]))
+        | (rook_attacks(square, occupied) & (pieces[ROOK | color] | pieces[QUEEN | color]));
+}
+
+// check if square is attacked (by the opponent of color)
+template <Byte color>
+bool Board::is_attacked(Byte square) {
+
+    STAT_INC(STAT_IS_ATTACKED);
+    STAT_TIMER(TIMER_IS_ATTACKED);
+
+    return attackers(board120[square], colors[0] | colors[1], Side<color>::them) != 0;
+}
+
+#else
+
+// check if square is attacked
+// only the opponent pieces (piece lists) that could reach the square (relation table) are looked at,
+// and for sliders only the squares between them and the target
+template <Byte color>
+bool Board::is_attacked(Byte square) {
+
+    STAT_INC(STAT_IS_ATTACKED);
+    STAT_TIMER(TIMER_IS_ATTACKED);
+
+    constexpr Byte them = Side<color>::them;
+
+    // pawn attacks
+    Piece pawn = Piece{s_Byte(PAWN | them)};
+
+    if (board[square + Side<color>::up_left] == pawn || board[square + Side<color>::up_right] == pawn) {
+        return true;
+    }
+
+    // knight/king attacks
+    for (int type = KNIGHT; type <= KING; type += 4) {
+
+        Piece piece = Piece{s_Byte(type | them)};
+
+        for (int i = 0; i < piece_num[piece.val]; i++) {
+            if (relation(piece_list[piece.val][i], square).attackers & 1 << type) {
+                return true;
+            }
+        }
+    }
+
+    // sliding attacks (bishop/rook/queen), the squares in between must be empty
+    for (int type = BISHOP; type <= QUEEN; type++) {
+
+        Piece slider = Piece{s_Byte(type | them)};
+
+        for (int i = 0; i < piece_num[slider.val]; i++) {
+
+            Byte from = piece_list[slider.val][i];
+            const SquareRelation& rel = relation(from, square);
+
+            if (rel.attackers & 1 << type) {
+
+                Byte sq = from + rel.step;
+
+                while (sq != square && board[sq] == EMPTY) {
+                    sq += rel.step;
+                }
+
+                if (sq == square) {
+                    return true;
+                }
+            }
+        }
+    }
+
+    // square is not under attack
+    return false;
+}
+
+#endif
+
+// check if square is attacked by the opponent of color
+bool Board::is_attacked(Byte square, Byte color) {
+    return color == WHITE ? is_attacked<WHITE>(square) : is_attacked<BLACK>(square);
+}
+
+// returns all possible moves of piece on given square
+vector<Move> Board::possible_moves(Byte square) {
+
+    STAT_INC(STAT_POSSIBLE_MOVES);
+
+    MoveList moves;
+    add_moves(square, moves);
+
+    return vector<Move>(moves.begin(), moves.end());
+}
 
-    int start = 0;
-    int end = fen.find(' ');
+// adds all possible moves of piece on given square to move list (pseudo legal, without allocating)
+void Board::possible_moves(Byte square, MoveList& moves) {
+    STAT_INC(STAT_POSSIBLE_MOVES);
+    add_moves(square, moves);
+}
 
-    for (int i = 0; i < 6; i++) {
+// checks a move that was not generated in this position (like a move from the transposition table):
+// it must be one of the possible moves of a piece of the side to play and must not leave the king in check
+bool Board::is_legal(Move move) {
 
-        fensplit[i] = fen.substr(start, end-start);
+    Piece piece = board[move.start];
 
-        start = end + 1;
-        end = fen.find(' ', start);
+    if (!piece.is_piece() || piece.color() != (turn ? BLACK : WHITE)) {
+        return false;
     }
 
-    // set up board
+    MoveList moves;
+    add_moves(move.start, moves);
 
-    for (int i = 0; i < 21; i++) {      // set first 2 sentinel ranks out of bounds
-        board[i] = OUTSIDE_BOARD;
+    for (Move m : moves) {
+        if (m.end == move.end && m.flag == move.flag && m.captured == move.captured) {
+            bool legal = make_move(m);
+            unmake_move(m);
+            return legal;
+        }
     }
 
-    int pos = 21;
+    return false;
+}
 
-    for (char c : fensplit[0]) {
+// piece values of the exchange, a king can only capture last (taking it would end the exchange)
+static inline int see_value(Byte type) {
+    return type == KING ? 20000 : piece_value[type];
+}
 
-        if (c == '/') {        // set sentinel files out of bounds
-            board[pos] = OUTSIDE_BOARD;
-            board[pos + 1] = OUTSIDE_BOARD;
-            pos += 2;
-        } else if (isdigit(c)) {   // leave squares empty
-            pos += c - '0';
-        } else {
-            board[pos] = letter2piece.at(c);
+// square of the least valuable piece of the given color that attacks square on pos (0 if there is none)
+// sliders are found behind pieces that already took part in the exchange, because those are removed from pos
+static Byte least_valuable_attacker(Piece pos[120], Byte square, Byte color) {
+
+    int coloroffset = color / 4 - 1;  // WHITE: 0 -> -1     BLACK: 8 -> 1
+
+    for (Byte from : {Byte(square - 9 * coloroffset), Byte(square - 11 * coloroffset)}) {
+        if (pos[from] == Piece{s_Byte(PAWN | color)}) {
+            return from;
+        }
+    }
+
+    for (int type = KNIGHT; type <= KING; type++) {
+
+        Piece attacker = Piece{s_Byte(type | color)};
+
+        for (int i = 0; i < offsetnum[type - 2]; i++) {
 
-            if (c == 'K') {
-                kings[0] = pos;
-            } else if (c == 'k') {
-                kings[1] = pos;
+            int offset = offsets[type - 2][i];
+            Byte from = square + offset;
+
+            while (sliding[type - 2] && pos[from] == EMPTY) {
+                from += offset;
             }
 
-            pos++;
+            if (pos[from] == attacker) {
+                return from;
+            }
         }
     }
 
-    for (int i = pos; i < 120; i++) {   // set last 2 sentinel ranks out of bounds
-        board[i] = OUTSIDE_BOARD;
+    return 0;
+}
+
+/*  static exchange evaluation: the material the side to play wins with a capture (or promotion) if both sides
+    keep capturing on the target square with their least valuable piece, and each side can stop when continuing
+    would lose material. computed on a copy of the board with the swap list algorithm, pins are not considered.
+    see https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+*/
+int Board::see(Move move) {
+
+    Piece pos[120];
+    copy(board, board + 120, pos);
+
+    Piece piece = pos[move.start];
+    int coloroffset = piece.color() / 4 - 1;
+
+    int gain[32];                   // gain[d] = material won by the side that made capture d, if the exchange stops after it
+    int d = 0;
+    int on_square = see_value(piece.type());     // value of the piece that can be captured next
+
+    gain[0] = move.captured.is_piece() ? see_value(move.captured.type()) : 0;
+
+    if (move.flag == EN_PASSANT) {
+        gain[0] = see_value(PAWN);
+        pos[move.end - 10 * coloroffset] = EMPTY;
+    } else if (move.flag >= KNIGHT_PROMO && move.flag <= QUEEN_PROMO) {
+        gain[0] += see_value(move.flag) - see_value(PAWN);
+        on_square = see_value(move.flag);
     }
 
-    // set active color
-    turn = fensplit[1] == "b";
+    pos[move.start] = EMPTY;
+    Byte color = piece.color() ^ BLACK;
 
-    // set castling rights
-    if (fensplit[2] != "-") {
+    while (d < 31) {
 
-        for (char c : fensplit[2]) {
+        Byte from = least_valuable_attacker(pos, move.end, color);
 
-            Piece p = letter2piece.at(c);
-            castle_rights[p.color()/4 + (p.val & 1)] = true;
+        if (!from) {
+            break;
         }
-    }
 
-    // set en passant target square
-    if (fensplit[3] != "-") {
-        en_pass_sq = algebraic2int(fensplit[3][0], fensplit[3][1]);
+        d++;
+        gain[d] = on_square - gain[d - 1];
+        on_square = see_value(pos[from].type());
+        pos[from] = EMPTY;
+        color ^= BLACK;
     }
 
-    // set halfmove clock
-    halfmove = stoi(fensplit[4]);
+    // going back, every side only captures if that is better than stopping
+    for (; d > 0; d--) {
+        gain[d - 1] = -max(-gain[d - 1], gain[d]);
+    }
 
-    //set fullmove number
-    fullmove = stoi(fensplit[5]);
+    return gain[0];
 }
 
-// get piece on given square
-Piece Board::get(Byte square) {
-    return board[square];
-}
+// see(move) >= threshold, without resolving the exchange further than needed to decide it
+bool Board::see_ge(Move move, int threshold) {
 
-// move piece from start square to end square
-// if the move is legal, returns true
-bool Board::make_move(Move m) { 
-    assert(m.start >= 0 && m.start < 120 && m.end >= 0 && m.end < 120);
-    assert(board[m.start] != OUTSIDE_BOARD && board[m.end] != OUTSIDE_BOARD);
-    assert(halfmove <= 50);
+    Piece piece = board[move.start];
+    int coloroffset = piece.color() / 4 - 1;
 
-    Piece piece = board[m.start];
-    en_pass_sq = 0;
-    
-    // check flag
-    switch (m.flag) {
+    int captured = move.captured.is_piece() ? see_value(move.captured.type()) : 0;
+    int on_square = see_value(piece.type());
 
-        case EN_PASSANT: {
-            Byte en_pass_capt = m.start > m.end ? m.end + 10 : m.end - 10;
-            board[en_pass_capt] = EMPTY;
+    if (move.flag == EN_PASSANT) {
+        captured = see_value(PAWN);
+    } else if (move.flag >= KNIGHT_PROMO && move.flag <= QUEEN_PROMO) {
+        captured += see_value(move.flag) - see_value(PAWN);
+        on_square = see_value(move.flag);
+    }
+
+    // swap: what the side that would capture next has to win back to beat the threshold
+    int swap = captured - threshold;
+
+    if (swap < 0) {             // not enough even if the piece isn't recaptured
+        return false;
+    }
+
+    swap = on_square - swap;
+
+    if (swap <= 0) {            // enough even if the piece is recaptured for nothing
+        return true;
+    }
+
+    // the board is only copied when the exchange has to be played out
+    Piece pos[120];
+    copy(board, board + 120, pos);
+
+    if (move.flag == EN_PASSANT) {
+        pos[move.end - 10 * coloroffset] = EMPTY;
+    }
+
+    pos[move.start] = EMPTY;
+    Byte color = piece.color();
+    bool result = true;         // flips with every capture, the side that makes the last capture wins
+
+    while (true) {
+
+        color ^= BLACK;
+        Byte from = least_valuable_attacker(pos, move.end, color);
+
+        if (!from) {
             break;
         }
-        
-        case KNIGHT_PROMO:
-        case BISHOP_PROMO:
-        case ROOK_PROMO:
-        case QUEEN_PROMO: {
-            piece = Piece{s_Byte(m.flag | piece.color())};
-            break;
+
+        result = !result;
+        Byte type = pos[from].type();
+
+        // a king can only capture if the piece isn't defended anymore
+        if (type == KING) {
+            return least_valuable_attacker(pos, move.end, color ^ BLACK) ? !result : result;
         }
 
-        case CASTLES: {
-            Byte rook_start = 21 + 70*(!piece.color()) + 7*(m.start < m.end);
-            Byte rook_end = 24 + 70*(!piece.color()) + 2*(m.start < m.end);
+        swap = see_value(type) - swap;
 
-            board[rook_end] = board[rook_start];
-            board[rook_start] = EMPTY;
+        if (swap < int(result)) {
             break;
         }
 
-        case TWO_FORWARD: {
-            en_pass_sq = (m.start + m.end)/2;
-            break;
+        pos[from] = EMPTY;
+    }
+
+    return result;
+}
+
+#ifdef BITBOARDS
+
+// adds a move from square to every target square (64 square indices)
+inline void Board::add_targets(int from, Bitboard targets, MoveList& moves) {
+
+    while (targets) {
+        int to = pop_lsb(targets);
+        moves.push(Move(board64[from], board64[to], board[board64[to]]));
+    }
+}
+
+// adds a pawn move, or the 4 promotions if the pawn reaches the last rank (64 square indices)
+// promotions are tactical moves, other pawn moves are tactical if they capture
+inline void add_pawn_move(int from, int to, Piece captured, MoveList& moves, GenType type) {
+
+    if (to < 8 || to >= 56) {
+        if (type != GEN_QUIETS) {
+            for (int p = KNIGHT_PROMO; p <= QUEEN_PROMO; p++) {
+                moves.push(Move(board64[from], board64[to], captured, (Flag)p));
+            }
         }
+    } else if (type != (captured.is_piece() ? GEN_QUIETS : GEN_CAPTURES)) {
+        moves.push(Move(board64[from], board64[to], captured));
     }
+}
 
-    // move piece
-    board[m.end] = piece;
-    board[m.start] = EMPTY;
+// fills move list with all legal moves of the side to play (or only the tactical / quiet ones)
+// moves of pinned pieces are restricted to the line through the king and the pinned piece,
+// and in check all moves except king moves must capture the checking piece or block the check
+template <Byte color>
+void Board::generate_moves(MoveList& moves, GenType type) {
 
-    // update king position if changed
-    if (piece.type() == KING) {
-        kings[piece.color()/8] = m.end;
+    moves.clear();
+
+    constexpr int us = Side<color>::index;
+    constexpr Byte them = Side<color>::them;
+    Bitboard own = colors[us];
+    Bitboard occupied = colors[0] | colors[1];
+
+    // target squares of the requested moves (pawn moves are sorted out by add_pawn_move)
+    Bitboard type_mask = type == GEN_CAPTURES ? colors[!us] : type == GEN_QUIETS ? ~occupied : ~0ULL;
+
+    Byte king = kings[us];
+    int ksq = board120[king];
+
+    Bitboard checkers = attackers(ksq, occupied, them);
+
+    // own pieces that are the only piece between the king and an opponent slider
+    Bitboard pinned = 0;
+    Bitboard snipers = (rook_attacks(ksq, 0) & (pieces[ROOK | them] | pieces[QUEEN | them]))
+                     | (bishop_attacks(ksq, 0) & (pieces[BISHOP | them] | pieces[QUEEN | them]));
+
+    while (snipers) {
+        Bitboard between = between_bb[ksq][pop_lsb(snipers)] & occupied;
+
+        if (between && !(between & (between - 1)) && (between & own)) {
+            pinned |= between;
+        }
+    }
+
+    // king moves, without the king on the board so it doesn't hide attacks on the squares behind it
+    Bitboard without_king = occupied ^ square_bb(ksq);
+
+    for (Bitboard b = king_attacks[ksq] & ~own & type_mask; b; ) {
+        int to = pop_lsb(b);
+
+        if (!attackers(to, without_king, them)) {
+            moves.push(Move(king, board64[to], board[board64[to]]));
+        }
     }
 
-    // remove castling rights
-    if (m.start == 25) {            // black king starting square
-        castle_rights[3] = false;
-        castle_rights[2] = false;
+    // double check, only the king can move
+    if (checkers & (checkers - 1)) {
+        return;
+    }
 
-    } else if (m.start == 95) {     // white king starting square
-        castle_rights[1] = false;
-        castle_rights[0] = false;
+    // squares that capture the checking piece or block the check
+    Bitboard targets = checkers ? between_bb[ksq][lsb(checkers)] | checkers : ~0ULL;
 
-    } else if (m.start == 21 || m.end == 21) {  // black rook queenside starting square
-        castle_rights[3] = false;
+    // castles, not in check and not through attacked squares
+    if (!checkers && type != GEN_CAPTURES) {
 
-    } else if (m.start == 28 || m.end == 28) {  // black rook kingside starting square
-        castle_rights[2] = false;
+        if ((castle_rights & Side<color>::oo) && board[king + 1] == EMPTY && board[king + 2] == EMPTY
+            && !attackers(ksq + 1, occupied, them) && !attackers(ksq + 2, occupied, them)) {
+            moves.push(Move(king, king + 2, EMPTY, CASTLES));
+        }
 
-    } else if (m.start == 91 || m.end == 91) {  // white rook queenside starting square
-        castle_rights[1] = false;
-        
-    } else if (m.start == 98 || m.end == 98) {  // white rook kingside starting square
-        castle_rights[0] = false;   
+        if ((castle_rights & Side<color>::ooo)
+            && board[king - 1] == EMPTY && board[king - 2] == EMPTY && board[king - 3] == EMPTY
+            && !attackers(ksq - 1, occupied, them) && !attackers(ksq - 2, occupied, them)) {
+            moves.push(Move(king, king - 2, EMPTY, CASTLES));
+        }
     }
 
-    // update fullmove, the counter updates after black moves
-    fullmove += turn;
+    // pawns, white pawns move to lower bit indices
+    Bitboard pawns = pieces[PAWN | color];
+    constexpr Bitboard start_rank = color == WHITE ? RANK_2 : RANK_7;
+    constexpr int forward = color == WHITE ? -8 : 8;
 
-    // update halfmove, the counter is reset after captures or pawn moves, and incremented otherwise
-    if (m.captured != EMPTY || piece.type() == PAWN) {
-        halfmove = 0;
-    } else {
-        halfmove++;
+    for (Bitboard b = pawns; b; ) {
+        int from = pop_lsb(b);
+        Bitboard allowed = targets & (pinned & square_bb(from) ? line_bb[ksq][from] : ~0ULL);
+
+        int to = from + forward;
+
+        if (!(occupied & square_bb(to))) {
+
+            if (allowed & square_bb(to)) {
+                add_pawn_move(from, to, EMPTY, moves, type);
+            }
+
+            if (type != GEN_CAPTURES && (start_rank & square_bb(from)) && !(occupied & square_bb(to + forward)) && (allowed & square_bb(to + forward))) {
+                moves.push(Move(board64[from], board64[to + forward], EMPTY, TWO_FORWARD));
+            }
+        }
+
+        for (Bitboard captures = pawn_attacks[us][from] & colors[!us] & allowed; captures; ) {
+            int capture = pop_lsb(captures);
+            add_pawn_move(from, capture, board[board64[capture]], moves, type);
+        }
     }
 
-    // update turn
-    turn = !turn;
+    // en passant removes two pieces from a line, so it is checked by making the move
+    if (en_pass_sq && type != GEN_QUIETS) {
+        for (Bitboard b = pawn_attacks[!us][board120[en_pass_sq]] & pawns; b; ) {
 
-    // check if move was legal
-    int castled = (m.flag == CASTLES) * (m.start - m.end)/2;
-    return move_was_legal(piece.color(), castled);
+            Move m(board64[pop_lsb(b)], en_pass_sq, EMPTY, EN_PASSANT);
+            bool legal = make_move(m);
+            unmake_move(m);
+
+            if (legal) {
+                moves.push(m);
+            }
+        }
+    }
+
+    // knights (a pinned knight can never move), bishops, rooks, queens
+    Bitboard allowed = ~own & targets & type_mask;
+
+    for (Bitboard b = pieces[KNIGHT | color] & ~pinned; b; ) {
+        int from = pop_lsb(b);
+        add_targets(from, knight_attacks[from] & allowed, moves);
+    }
+
+    for (Bitboard b = pieces[BISHOP | color] | pieces[QUEEN | color]; b; ) {
+        int from = pop_lsb(b);
+        add_targets(from, bishop_attacks(from, occupied) & allowed & (pinned & square_bb(from) ? line_bb[ksq][from] : ~0ULL), moves);
+    }
+
+    for (Bitboard b = pieces[ROOK | color] | pieces[QUEEN | color]; b; ) {
+        int from = pop_lsb(b);
+        add_targets(from, rook_attacks(from, occupied) & allowed & (pinned & square_bb(from) ? line_bb[ksq][from] : ~0ULL), moves);
+    }
 }
 
-// unmake last move made
-void Board::unmake_move(Move m) {
-    assert(m.start >= 0 && m.start < 120 && m.end >= 0 && m.end < 120);
-    assert(board[m.start] != OUTSIDE_BOARD && board[m.end] != OUTSIDE_BOARD);
+#else
 
-    Piece piece = board[m.end];
+// check if square is on the ray from the king in direction dir, at most n steps away
+static inline bool on_ray(int square, int king, int dir, int n) {
+    int diff = square - king;
+    return diff % dir == 0 && diff / dir >= 1 && diff / dir <= n;
+}
 
-    // check flag
-    switch (m.flag) {
+// fills move list with all legal moves of the side to play
+// (or only the tactical / quiet ones, selected from the moves of each piece)
+// checking and pinned pieces are found once by looking from the king in every direction,
+// then moves of pinned pieces must stay on the pin ray and in check moves must capture or block the checking piece
+template <Byte color>
+void Board::generate_moves(MoveList& moves, GenType type) {
 
-        case EN_PASSANT: {
-            Byte en_pass_capt = m.start > m.end ? m.end + 10 : m.end - 10;
-            board[en_pass_capt] = Piece{s_Byte(PAWN | !piece.color() * 8)};
-            break;
+    moves.clear();
+
+    Byte king = kings[Side<color>::index];
+
+    int checkers = 0;
+    Byte check_sq = 0;      // square of the checking piece
+    int check_dir = 0;      // direction from the king to a sliding checker (0 -> knight or pawn)
+    int check_n = 0;        // steps from the king to a sliding checker
+
+    Byte pin_sq[8];         // pinned pieces, with direction and steps from the king to the pinning piece
+    int pin_dir[8];
+    int pin_n[8];
+    int pins = 0;
+
+    // sliding checks and pins
+    for (int i = 0; i < 8; i++) {
+
+        int dir = offsets[3][i];
+        Byte slider = (dir == -11 || dir == -9 || dir == 9 || dir == 11) ? BISHOP : ROOK;
+
+        int n = 1;
+        Byte sq = king + dir;
+
+        while (board[sq] == EMPTY) {
+            sq += dir;
+            n++;
         }
-        
-        case KNIGHT_PROMO:
-        case BISHOP_PROMO:
-        case ROOK_PROMO:
-        case QUEEN_PROMO: {
-            piece = Piece{s_Byte(PAWN | piece.color())};
-            break;
+
+        if (!board[sq].is_piece()) {
+            continue;
         }
 
-        case CASTLES: {
-            Byte rook_start = 21 + 70*(!piece.color()) + 7*(m.start < m.end);
-            Byte rook_end = 24 + 70*(!piece.color()) + 2*(m.start < m.end);
+        if (board[sq].color() != color) {
 
-            board[rook_start] = board[rook_end];
-            board[rook_end] = EMPTY;
-            break;
+            if (board[sq].type() == slider || board[sq].type() == QUEEN) {
+                checkers++;
+                check_sq = sq;
+                check_dir = dir;
+                check_n = n;
+            }
+
+            continue;
+        }
+
+        // own piece, pinned if the next piece on the ray is an opponent slider of this direction
+        Byte pinned = sq;
+
+        do {
+            sq += dir;
+            n++;
+        } while (board[sq] == EMPTY);
+
+        if (board[sq].is_piece() && board[sq].color() != color && (board[sq].type() == slider || board[sq].type() == QUEEN)) {
+            pin_sq[pins] = pinned;
+            pin_dir[pins] = dir;
+            pin_n[pins] = n;
+            pins++;
         }
     }
 
-    // move piece
-    board[m.start] = board[m.end];
-    board[m.end] = m.captured;
+    // knight and pawn checks
+    for (int offset : offsets[0]) {
 
-    // update king position if changed
-    if (piece.type() == KING) {
-        kings[piece.color()/8] = m.start;
+        Piece p = board[king + offset];
+
+        if (p.is_piece() && p.color() != color && p.type() == KNIGHT) {
+            checkers++;
+            check_sq = king + offset;
+            check_dir = 0;
+        }
     }
 
-    // update turn
-    turn = !turn;
+    for (int offset : {Side<color>::up_right, Side<color>::up_left}) {
 
-    // update fullmove, the counter updates after black moves
-    fullmove -= turn;
+        Piece p = board[king + offset];
 
-    // TODO: update en_pass_sq, halfmove clock, castling rights (stack)
-}
+        if (p.is_piece() && p.color() != color && p.type() == PAWN) {
+            checkers++;
+            check_sq = king + offset;
+            check_dir = 0;
+        }
+    }
 
+    // king moves, without the king on the board so it doesn't hide attacks on the squares behind it
+    Piece king_piece = board[king];
+    board[king] = EMPTY;
 
-// check if last move made was legal
-bool Board::move_was_legal(Byte color, int castled) {   // castled = 0 -> didnt castle, castled = 1 -> castled kingside, castled = -1 -> castled queenside
+    for (int offset : offsets[4]) {
 
-    Byte kingpos = kings[color/8];
+        Byte target_index = king + offset;
+        Piece target = board[target_index];
 
-    if (castled) {  // last move was castling
-        return !is_attacked(kingpos, color) && !is_attacked(kingpos + castled, color) && !is_attacked(kingpos + castled*2, color);
-    } else {
-        return !is_attacked(kingpos, color);
+        if (target != OUTSIDE_BOARD && (target == EMPTY ? type != GEN_CAPTURES : target.color() != color && type != GEN_QUIETS)
+            && !is_attacked<color>(target_index)) {
+            moves.push(Move(king, target_index, target));
+        }
     }
-}
 
-// check if square is attacked
-bool Board::is_attacked(Byte square, Byte color) {
+    board[king] = king_piece;
 
-    // knight/king attacks
-    for (int piece = KNIGHT; piece <= KING; piece += 4) {
+    // double check, only the king can move
+    if (checkers > 1) {
+        return;
+    }
 
-        for (int offset : offsets[piece-2]) {
+    // castles, not in check and not through attacked squares
+    if (!checkers && type != GEN_CAPTURES) {
 
-            Piece target = board[square + offset];
-            if (target.is_piece() && target.color() != color && target.type() == piece) {
-                return true;
-            }
+        if ((castle_rights & Side<color>::oo) && board[king + 1] == EMPTY && board[king + 2] == EMPTY
+            && !is_attacked<color>(king + 1) && !is_attacked<color>(king + 2)) {
+            moves.push(Move(king, king + 2, EMPTY, CASTLES));
+        }
+
+        if ((castle_rights & Side<color>::ooo)
+            && board[king - 1] == EMPTY && board[king - 2] == EMPTY && board[king - 3] == EMPTY
+            && !is_attacked<color>(king - 1) && !is_attacked<color>(king - 2)) {
+            moves.push(Move(king, king - 2, EMPTY, CASTLES));
         }
     }
 
-    // sliding attacks (bishop/rook/queen)
-    for (int piece = BISHOP; piece <= ROOK; piece++) {
+    // other pieces, from the piece lists (copied, because making an en passant move below reorders the pawn list)
+    for (int piece_type = PAWN; piece_type <= QUEEN; piece_type++) {
 
-        for (int j = 0; j < 4; j++) {
+        Piece piece = Piece{s_Byte(piece_type | color)};
+        Byte squares[MAX_PIECES];
+        int num = piece_num[piece.val];
 
-            Byte offset = offsets[piece-2][j];
-            Byte target_index = square + offset;
-            Piece target = board[target_index];
+        copy(piece_list[piece.val], piece_list[piece.val] + num, squares);
 
-            while (target == EMPTY) {
-                target_index += offset;
-                target = board[target_index];
+        for (int n = 0; n < num; n++) {
+
+            Byte sq = squares[n];
+
+            int first = moves.size;
+            add_moves<color>(sq, moves);
+
+            int pin = -1;
+            for (int i = 0; i < pins; i++) {
+                if (pin_sq[i] == sq) {
+                    pin = i;
+                }
             }
 
-            if (target.is_piece() && target.color() != color && (target.type() == piece || target.type() == QUEEN)) {
-                return true;
+            if (pin < 0 && !checkers && !en_pass_sq && type == GEN_ALL) {    // all moves are legal
+                continue;
+            }
+
+            // remove illegal moves and moves of the other type
+            int kept = first;
+
+            for (int i = first; i < moves.size; i++) {
+
+                Move m = moves[i];
+                bool legal;
+
+                if (type != GEN_ALL && is_tactical(m) != (type == GEN_CAPTURES)) {
+                    continue;
+                }
+
+                if (m.flag == EN_PASSANT) {     // removes two pieces from a line, so it is checked by making the move
+                    legal = make_move(m);
+                    unmake_move(m);
+                } else {
+                    legal = (pin < 0 || on_ray(m.end, king, pin_dir[pin], pin_n[pin]))
+                        && (!checkers || m.end == check_sq || (check_dir && on_ray(m.end, king, check_dir, check_n - 1)));
+                }
+
+                if (legal) {
+                    moves[kept++] = m;
+                } else if (m.flag != EN_PASSANT) {      // en passant is counted by make_move
+                    STAT_INC(STAT_ILLEGAL_MOVES);
+                }
             }
+
+            moves.size = kept;
         }
     }
+}
 
-    // pawn attacks
-    int coloroffset = color / 4 - 1;  // WHITE: 0 -> -1     BLACK: 8 -> 1
-    Piece infrontl = board[square + 11 * coloroffset];
-    Piece infrontr = board[square + 9 * coloroffset];
+#endif
 
-    if ((infrontl.is_piece() && infrontl.color() != color && infrontl.type() == PAWN) || 
-        (infrontr.is_piece() && infrontr.color() != color && infrontr.type() == PAWN)) {
-        return true;
+// the side to play is dispatched once, the generation of each side is compiled separately
+void Board::generate_moves(MoveList& moves, GenType type) {
+
+    STAT_INC(STAT_GENERATE_MOVES);
+    STAT_TIMER(TIMER_GENERATE_MOVES);
+
+    if (turn) {
+        generate_moves<BLACK>(moves, type);
+    } else {
+        generate_moves<WHITE>(moves, type);
     }
 
-    // square is not under attack
-    return false;
+    STAT_ADD(STAT_GENERATED_MOVES, moves.size);
 }
 
-// returns all possible moves of piece on given square
-vector<Move> Board::possible_moves(Byte square) {
+// adds all possible moves of piece on given square to move list
+void Board::add_moves(Byte square, MoveList& moves) {
+
+    if (board[square].color() == WHITE) {
+        add_moves<WHITE>(square, moves);
+    } else {
+        add_moves<BLACK>(square, moves);
+    }
+}
+
+// adds all possible moves of a piece of the given color on given square to move list
+template <Byte color>
+void Board::add_moves(Byte square, MoveList& moves) {
     assert(square >= 0 && square < 120 && en_pass_sq >= 0 && en_pass_sq < 120);
 
     Piece piece = board[square];
 
-    vector<Move> moves;
-
     if (piece.type() == PAWN) {      // piece is pawn
         
         if (square > 30 && square < 89) {   // pawn is not on last (or first) rank (should be impossible because of promotion)
 
-            int coloroffset = piece.color() / 4 - 1;  // WHITE: 0 -> -1     BLACK: 8 -> 1
-
-            int infront = square + 10 * coloroffset;
-            int infrontl = square + 11 * coloroffset;
-            int infrontr = square + 9 * coloroffset;
-            int infront2 = square + 20 * coloroffset;
+            int infront = square + Side<color>::up;
+            int infrontl = square + Side<color>::up_left;
+            int infrontr = square + Side<color>::up_right;
+            int infront2 = square + 2 * Side<color>::up;
 
 
             // pawn promotion
-            if ((piece.color() == WHITE && square < 39) || (piece.color() == BLACK && square > 80)) {
+            if (Side<color>::promotion_rank(square)) {
                 
                 // square in front is empty
                 if (board[infront] == EMPTY) {
                     for (int p = 2; p < 6; p++) {
-                        moves.push_back(Move(square, infront, EMPTY, (Flag)p));    // pawn moves forward 1 square
+                        moves.push(Move(square, infront, EMPTY, (Flag)p));    // pawn moves forward 1 square
                     }
                 }
 
                 // square in front left is occupied by opponent piece
-                if (board[infrontl].val > 0 && board[infrontl].color() != piece.color()) {
+                if (board[infrontl].val > 0 && board[infrontl].color() != color) {
                     for (int p = 2; p < 6; p++) {
-                        moves.push_back(Move(square, infrontl, board[infrontl], (Flag)p));   // pawn captures in front left
+                        moves.push(Move(square, infrontl, board[infrontl], (Flag)p));   // pawn captures in front left
                     }
                 }
 
                 // square in front right is occupied by opponent piece
-                if (board[infrontr].val > 0 && board[infrontr].color() != piece.color()) {
+                if (board[infrontr].val > 0 && board[infrontr].color() != color) {
                     for (int p = 2; p < 6; p++) {
-                        moves.push_back(Move(square, infrontr, board[infrontr], (Flag)p));    // pawn captures in front right
+                        moves.push(Move(square, infrontr, board[infrontr], (Flag)p));    // pawn captures in front right
                     }
                 }
 
@@ -337,24 +1491,23 @@ vector<Move> Board::possible_moves(Byte square) {
 
                 // square in front is empty
                 if (board[infront] == EMPTY) {
-                    moves.push_back(Move(square, infront, EMPTY)); // pawn moves forward 1 square
+                    moves.push(Move(square, infront, EMPTY)); // pawn moves forward 1 square
                 }
 
                 // square in front left is occupied by opponent piece OR en passant is possible here
-                if (infrontl == en_pass_sq || (board[infrontl].val > 0 && board[infrontl].color() != piece.color())) {
-                    moves.push_back(Move(square, infrontl, board[infrontl], infrontl == en_pass_sq ? EN_PASSANT : NO_FLAG)); // pawn captures in front left
+                if (infrontl == en_pass_sq || (board[infrontl].val > 0 && board[infrontl].color() != color)) {
+                    moves.push(Move(square, infrontl, board[infrontl], infrontl == en_pass_sq ? EN_PASSANT : NO_FLAG)); // pawn captures in front left
                 }
 
                 // square in front right is occupied by opponent piece OR en passant is possible here
-                if (infrontr == en_pass_sq || (board[infrontr].val > 0 && board[infrontr].color() != piece.color())) {
-                    moves.push_back(Move(square, infrontr, board[infrontr], infrontr == en_pass_sq ? EN_PASSANT : NO_FLAG)); // pawn captures in front right
+                if (infrontr == en_pass_sq || (board[infrontr].val > 0 && board[infrontr].color() != color)) {
+                    moves.push(Move(square, infrontr, board[infrontr], infrontr == en_pass_sq ? EN_PASSANT : NO_FLAG)); // pawn captures in front right
                 }
 
                 // pawn is on starting rank and 2 squares in front are empty
-                if (((piece.color() == WHITE && square > 80) || (piece.color() == BLACK && square < 39)) 
-                    && board[infront] == EMPTY && board[infront2] == EMPTY) {
+                if (Side<color>::start_rank(square) && board[infront] == EMPTY && board[infront2] == EMPTY) {
 
-                    moves.push_back(Move(square, infront2, EMPTY, TWO_FORWARD)); // pawn moves forward 2 squares
+                    moves.push(Move(square, infront2, EMPTY, TWO_FORWARD)); // pawn moves forward 2 squares
                 }
             }
         }
@@ -371,34 +1524,33 @@ vector<Move> Board::possible_moves(Byte square) {
             Piece target = board[target_index];
 
             while (sliding[piecetype] && target == EMPTY) {    // piece is sliding type (bishop, rook or queen) AND target square is empty
-                moves.push_back(Move(square, target_index, EMPTY));
+                moves.push(Move(square, target_index, EMPTY));
 
                 target_index += offset;
                 target = board[target_index];
             }
 
-            if (target != OUTSIDE_BOARD && (target == EMPTY || (target.color() != piece.color()))) {    // target square is in bounds AND is empty OR occupied by opponent piece
-                moves.push_back(Move(square, target_index, target));
+            if (target != OUTSIDE_BOARD && (target == EMPTY || (target.color() != color))) {    // target square is in bounds AND is empty OR occupied by opponent piece
+                moves.push(Move(square, target_index, target));
             }
         }
 
-        
-        // TODO: check if squares are not attacked
-        // castles
 
-        if (piece.type() == KING && castle_rights[piece.color()/4]
+        // castles, pseudo-legal: only the rights and empty squares are checked here,
+        // generate_moves drops castling out of, through or into check
+
+        if (piece.type() == KING && (castle_rights & Side<color>::oo)
             && board[square + 1] == EMPTY && board[square + 2] == EMPTY) {                                  // kingside castles
             
-            moves.push_back(Move(square, square + 2, EMPTY, CASTLES));
-        
-        } else if (piece.type() == KING && castle_rights[piece.color()/4 + 1] 
+            moves.push(Move(square, square + 2, EMPTY, CASTLES));
+        }
+
+        if (piece.type() == KING && (castle_rights & Side<color>::ooo)
             && board[square - 1] == EMPTY && board[square - 2] == EMPTY && board[square - 3] == EMPTY) {    // queenside castles
             
-            moves.push_back(Move(square, square - 2, EMPTY, CASTLES));
+            moves.push(Move(square, square - 2, EMPTY, CASTLES));
         }
     }
-
-    return moves;
 }
 
 std::ostream& operator<<(std::ostream& os, Board& b) {
@@ -417,7 +1569,7 @@ std::ostream& operator<<(std::ostream& os, Board& b) {
     bool nl = false;
 
     for (int i=0; i<4; i++) {
-        if (b.castle_rights[i]) {
+        if (b.castle_rights & (1 << i)) {
             os << piece2letter[6 + (i/2)*8 - i%2];
             nl = true;
         }
@@ -454,4 +1606,16 @@ string int2algebraic(int square) {
     char file = s%8 + 'a';
 
     return string({file, rank});
+}
+
+// move in long algebraic notation (e.g. e2e4, e7e8q)
+string move2str(Move m) {
+
+    string str = int2algebraic(m.start) + int2algebraic(m.end);
+
+    if (m.flag >= KNIGHT_PROMO && m.flag <= QUEEN_PROMO) {
+        str += piece2letter[m.flag | BLACK];
+    }
+
+    return str;
 }
\ No newline at end of file
@@ -6,7 +6,11 @@
 #include <string>
 #include <iostream>
 #include <vector>
-#include <map>
+#include <string_view>
+
+#include "bitboard.hpp"
+#include "zobrist.hpp"
+#include "psqt.hpp"
 
 using namespace std;
 
@@ -45,22 +49,30 @@ const s_Byte BLACK     = 8;   // 1000
 // piece & 8 -> color
 // piece & 7 -> piece type
 
-const char piece2letter[] = {' ', 'P', 'N', 'B', 'R', 'Q', 'K', '?', '?', 'p', 'n', 'b', 'r', 'q', 'k'};
-const map<char, Piece> letter2piece = { 
-    {'P', Piece{PAWN   | WHITE}}, 
-    {'N', Piece{KNIGHT | WHITE}}, 
-    {'B', Piece{BISHOP | WHITE}}, 
-    {'R', Piece{ROOK   | WHITE}}, 
-    {'Q', Piece{QUEEN  | WHITE}}, 
-    {'K', Piece{KING   | WHITE}}, 
-    {'p', Piece{PAWN   | BLACK}}, 
-    {'n', Piece{KNIGHT | BLACK}}, 
-    {'b', Piece{BISHOP | BLACK}}, 
-    {'r', Piece{ROOK   | BLACK}}, 
-    {'q', Piece{QUEEN  | BLACK}}, 
-    {'k', Piece{KING   | BLACK}}
+constexpr char piece2letter[] = {' ', 'P', 'N', 'B', 'R', 'Q', 'K', '?', '?', 'p', 'n', 'b', 'r', 'q', 'k'};
+
+// piece of each FEN letter (indexed by the ascii code), EMPTY for characters that are not pieces
+struct LetterTable {
+    Piece pieces[256];
+
+    Piece operator[](char c) const { return pieces[(unsigned char)c]; }     // bytes above 127 aren't letters of pieces
 };
 
+constexpr LetterTable make_letter_table() {
+
+    LetterTable table{};
+
+    for (int val = 1; val < 15; val++) {
+        if (piece2letter[val] != '?') {
+            table.pieces[(int)piece2letter[val]] = Piece{s_Byte(val)};
+        }
+    }
+
+    return table;
+}
+
+inline constexpr LetterTable letter2piece = make_letter_table();
+
 const string color_str[] = {"white", "black"};
 
 
@@ -124,10 +136,76 @@ const int board120[] = {
      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
 };
 
+
+/*  square relationship table, indexed by the difference of two board indices (to - from + 77).
+    for every difference it holds the piece types that can attack along it (bit 1 << type) and,
+    for sliders, the step that walks from one square to the other.
+    a difference can belong to two squares that are not on a line (h8 -> a7 is +3 like a8 -> d8), but walking
+    the step from a real square then always runs into a sentinel square first, so the walk rejects it.
+    pawns attack in one direction only, they are not in the table.
+*/
+
+struct SquareRelation {
+    Byte attackers;     // bit 1 << type for KNIGHT, BISHOP, ROOK, QUEEN, KING
+    s_Byte step;        // board index step from the first square to the second (sliders), 0 otherwise
+};
+
+struct RelationTable {
+    SquareRelation deltas[155];     // to - from ranges from -77 (h1 -> a8) to 77 (a8 -> h1)
+
+    constexpr const SquareRelation& operator()(int from, int to) const { return deltas[to - from + 77]; }
+};
+
+constexpr RelationTable make_relation_table() {
+
+    RelationTable table{};
+
+    for (int from = 0; from < 64; from++) {
+        for (int to = 0; to < 64; to++) {
+
+            int dr = to / 8 - from / 8;
+            int df = to % 8 - from % 8;
+            int adr = dr < 0 ? -dr : dr;
+            int adf = df < 0 ? -df : df;
+
+            if (from == to) {
+                continue;
+            }
+
+            SquareRelation& rel = table.deltas[(dr * 10 + df) + 77];
+            int step = (dr > 0) - (dr < 0);
+            step = step * 10 + (df > 0) - (df < 0);
+
+            if ((adr == 1 && adf == 2) || (adr == 2 && adf == 1)) {
+                rel.attackers |= 1 << KNIGHT;
+            }
+
+            if (adr <= 1 && adf <= 1) {
+                rel.attackers |= 1 << KING;
+            }
+
+            if (dr == 0 || df == 0) {
+                rel.attackers |= 1 << ROOK | 1 << QUEEN;
+                rel.step = step;
+            } else if (adr == adf) {
+                rel.attackers |= 1 << BISHOP | 1 << QUEEN;
+                rel.step = step;
+            }
+        }
+    }
+
+    return table;
+}
+
+inline constexpr RelationTable relation = make_relation_table();
+
 int algebraic2int(char file, char rank);
 
 string int2algebraic(int square);
 
+struct Move;
+string move2str(Move m);
+
 enum Flag : Byte {
     NO_FLAG =       0,
     EN_PASSANT =    1,
@@ -141,6 +219,7 @@ enum Flag : Byte {
 
 struct Move {
 
+    Move() {}
     Move(Byte start, Byte end, Piece captured, Flag flag) : start(start), end(end), captured(captured), flag(flag) {}
     Move(Byte start, Byte end, Piece captured) : Move(start, end, captured, NO_FLAG) {}
 
@@ -150,37 +229,114 @@ struct Move {
     Flag flag;
 };
 
+const int MAX_MOVES = 256;      // more than the maximum number of moves in any chess position
 
-struct State {
+// fixed capacity move list, lives on the stack so generating moves doesn't allocate
+struct MoveList {
+
+    Move moves[MAX_MOVES];
+    int size = 0;
+
+    void push(Move m) { moves[size++] = m; }
+    void clear() { size = 0; }
+
+    Move& operator[](int i) { return moves[i]; }
+    Move* begin() { return moves; }
+    Move* end() { return moves + size; }
+};
+
+// captures, en passant and promotions change the material, all other moves are quiet
+inline bool is_tactical(Move m) {
+    return m.captured.is_piece() || m.flag == EN_PASSANT || (m.flag >= KNIGHT_PROMO && m.flag <= QUEEN_PROMO);
+}
+
+// which legal moves generate_moves produces
+enum GenType {
+    GEN_ALL,
+    GEN_CAPTURES,       // tactical moves only
+    GEN_QUIETS          // everything else, castles included
+};
 
-    State(Byte en_pass_sq, Byte halfmove, bool p_castle_rights[4]) : en_pass_sq(en_pass_sq), halfmove(halfmove) {
-        
-        for (int i = 0; i < 4; i++) {
-            castle_rights = castle_rights | (p_castle_rights[i] << i);
-        }
-    }
 
+// castling rights bits, castle_rights = bitwise or of the remaining rights
+
+const Byte WHITE_OO    = 1;   // white kingside
+const Byte WHITE_OOO   = 2;   // white queenside
+const Byte BLACK_OO    = 4;   // black kingside
+const Byte BLACK_OOO   = 8;   // black queenside
+
+// castling rights that remain after a piece moves from or to a square (king and rook starting squares)
+const Byte castle_mask[] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  7, 15, 15, 15,  3, 15, 15, 11, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 13, 15, 15, 15, 12, 15, 15, 14, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15
+};
+
+// what depends on the side to play in the move generation, as compile time constants (10x12 board indices)
+// move generation and attack detection are templated on the color, so they don't branch on it
+template <Byte color>
+struct Side {
+    static constexpr Byte them = color ^ BLACK;
+    static constexpr int index = color / 8;                     // index of kings[], colors[]
+    static constexpr int up = color == WHITE ? -10 : 10;        // pawn moves
+    static constexpr int up_left = color == WHITE ? -11 : 11;   // pawn captures
+    static constexpr int up_right = color == WHITE ? -9 : 9;
+    static constexpr Byte oo = color == WHITE ? WHITE_OO : BLACK_OO;
+    static constexpr Byte ooo = color == WHITE ? WHITE_OOO : BLACK_OOO;
+
+    static constexpr bool promotion_rank(Byte square) { return color == WHITE ? square < 39 : square > 80; }    // pawn promotes with its next move
+    static constexpr bool start_rank(Byte square) { return color == WHITE ? square > 80 : square < 39; }       // pawn can move two squares
+};
+
+
+// irreversible part of the position, saved before every move so unmake_move can restore it
+struct State {
+    uint64_t key;
     Byte en_pass_sq;
-    Byte halfmove;
     Byte castle_rights;
-    State* prev;
+    int halfmove;
 };
 
-struct Stack {
+// result of parsing a FEN string
+enum FenError {
+    FEN_OK,
+    FEN_BAD_PLACEMENT,      // wrong number of ranks or files, unknown letter, pawn on the first or last rank
+    FEN_BAD_KINGS,          // not exactly one king of each color
+    FEN_BAD_SIDE,
+    FEN_BAD_CASTLING,       // unknown letter, or the king or rook is not on its starting square
+    FEN_BAD_EN_PASSANT,     // not on the 3rd/6th rank of the side that just moved, or no pawn that moved two squares
+    FEN_BAD_CLOCK           // halfmove clock or fullmove number out of range
+};
 
-    State* tos; // top of stack
+const string fen_error_str[] = {"ok", "bad piece placement", "bad kings", "bad side to play", "bad castling rights",
+                                "bad en passant square", "bad move counters"};
+
+// position in 28 bytes, for storing many positions (a FEN string takes up to about 90)
+// every position set_fen accepts with at most 32 pieces can be packed and unpacked without loss
+struct PackedPosition {
+    uint8_t occupancy[8];           // bit i of byte i / 8 set -> square i (a8 = 0, h1 = 63) is occupied
+    uint8_t pieces[16];             // Piece::val of the occupied squares from a8 to h1, two per byte, the first in the low 4 bits
+    uint8_t halfmove;               // halfmove clock, up to MAX_HALFMOVE
+    uint8_t castle_en_pass;         // castling rights in the low 4 bits, en passant file + 1 in the high 4 bits (0 -> none)
+    uint8_t turn_fullmove[2];       // little endian, fullmove number in the low 15 bits, side to play in bit 15
+};
 
-    void push(State* state) {
-        state->prev = tos;
-        tos = state;
-    }
+static_assert(sizeof(PackedPosition) == 28);
 
-    State* pop() {
-        State* top = tos;
-        tos = top->prev;
-        return top;
-    }
-};
+const int MAX_HISTORY = 1024;   // maximum number of moves made on a board
+
+const int MAX_HALFMOVE = 150;   // largest halfmove clock of a position, the 75 move rule ends a game at 150 plies
+
+const int MAX_PIECES = 10;      // maximum number of pieces of one type and color (2 + 8 promotions)
 
 
 class Board {
@@ -188,19 +344,62 @@ class Board {
         Piece board[120] = { EMPTY };
         Byte kings[2];                      // [white king position, black king position]
         Byte en_pass_sq = 0;                // en passant target square
-        bool castle_rights[4] = {false};    // [white kingside, white queenside, black kingside, black queenside]
+        Byte castle_rights = 0;             // castling rights bits (WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO)
         bool turn;                          // 0 -> white to play    1 -> black to play
-        Byte halfmove;                      // 0 to 50 (if 50 then draw)
+        int halfmove;                       // plies since the last capture or pawn move (100 -> draw by the fifty move rule)
         int fullmove;
-        Stack stack;
+        uint64_t key = 0;                   // zobrist key of the position
+        State history[MAX_HISTORY];         // states before each move made, history[ply - 1] is the last one
+        int ply = 0;                        // number of moves made on this board
+        Score psqt_score;                   // sum of the piece-square values of all pieces (white's point of view)
+        int phase = 0;                      // sum of phase_value of all pieces
+        Byte piece_list[15][MAX_PIECES];    // squares of the pieces of each type and color (indexed by Piece::val)
+        Byte piece_num[15] = {0};           // number of pieces in each list
+        Byte list_index[120];               // index of the piece on a square in its list
+#ifdef BITBOARDS
+        Bitboard pieces[15] = {0};          // squares occupied by each piece (indexed by Piece::val)
+        Bitboard colors[2] = {0};           // squares occupied by [white, black]
+        void add_targets(int from, Bitboard targets, MoveList& moves);
+        Bitboard attackers(int square, Bitboard occupied, Byte color);
+#endif
+        void clear();
+        bool has_room(Piece piece);
+        void put_piece(Byte square, Piece piece);
+        void remove_piece(Byte square);
+        void add_moves(Byte square, MoveList& moves);
+        template <Byte color> void add_moves(Byte square, MoveList& moves);
+        template <Byte color> void generate_moves(MoveList& moves, GenType type);
+        template <Byte color> bool is_attacked(Byte square);
     public:
-        explicit Board(string fen = FEN_START);
+        explicit Board(string_view fen = FEN_START);
+        FenError set_fen(string_view fen);
+        string to_fen();
+        FenError set_packed(const PackedPosition& packed);
+        bool to_packed(PackedPosition& packed);
         Piece get(Byte square);
-        bool make_move(Move move);
+        int count(Piece piece);
+        const Byte* squares(Piece piece);
+        bool get_turn();
+        int get_halfmove();
+        Byte get_castle_rights();
+        Byte get_en_pass_sq();
+        bool in_check();
+        uint64_t get_key();
+        uint64_t compute_key();
+        bool is_repetition(int times = 1);
+        Score get_psqt();
+        Score compute_psqt();
+        int get_phase();
+        bool make_move(Move move, bool check_legal = true);
         void unmake_move(Move move);
         bool move_was_legal(Byte color, int castled);
         bool is_attacked(Byte square, Byte color);
         vector<Move> possible_moves(Byte square);
+        void possible_moves(Byte square, MoveList& moves);
+        void generate_moves(MoveList& moves, GenType type = GEN_ALL);
+        bool is_legal(Move move);
+        int see(Move move);
+        bool see_ge(Move move, int threshold);
         friend std::ostream& operator<<(std::ostream& os, Board& b);
 };
 
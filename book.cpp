@@ -0,0 +1,214 @@
+#include "book.hpp"
+#include <cstdio>
+
+using namespace std;
+
+static uint64_t read_be(const unsigned char* p, int bytes) {
+
+    uint64_t n = 0;
+
+    for (int i = 0; i < bytes; i++) {
+        n = n << 8 | p[i];
+    }
+
+    return n;
+}
+
+Book::Book() {
+
+    for (int i = 0; i < POLYGLOT_KEYS; i++) {
+        random64[i] = polyglot_random64[i];
+    }
+}
+
+bool Book::load_keys(const char* path) {
+
+    FILE* f = fopen(path, "r");
+
+    if (!f) {
+        return false;
+    }
+
+    uint64_t keys[POLYGLOT_KEYS];
+    int n = 0;
+    unsigned long long k;
+
+    // hexadecimal numbers separated by white space or commas, with or without 0x and ULL
+    while (n < POLYGLOT_KEYS && fscanf(f, " %llx%*[ULul,]", &k) == 1) {
+        keys[n++] = k;
+    }
+
+    fclose(f);
+
+    if (n != POLYGLOT_KEYS) {
+        return false;
+    }
+
+    for (int i = 0; i < POLYGLOT_KEYS; i++) {
+        random64[i] = keys[i];
+    }
+
+    return true;
+}
+
+bool Book::open(const char* path) {
+
+    file.reset(new MappedFile(path));
+
+    if (!file->is_open() || file->view().size() % 16) {
+        file.reset();
+        entries = nullptr;
+        entry_num = 0;
+        return false;
+    }
+
+    entries = (const unsigned char*)file->view().data();
+    entry_num = file->view().size() / 16;
+
+    return true;
+}
+
+BookEntry Book::entry(size_t i) {
+
+    const unsigned char* p = entries + i * 16;
+    return BookEntry{read_be(p, 8), uint16_t(read_be(p + 8, 2)), uint16_t(read_be(p + 10, 2)), uint32_t(read_be(p + 12, 4))};
+}
+
+// index of the first entry with a key not less than key
+size_t Book::lower_bound(uint64_t key) {
+
+    size_t low = 0, high = entry_num;
+
+    while (low < high) {
+
+        size_t mid = (low + high) / 2;
+
+        if (read_be(entries + mid * 16, 8) < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+uint64_t Book::key(Board& b) {
+
+    uint64_t k = 0;
+
+    // pieces: kind is 0 for a black pawn, 1 for a white pawn, 2 for a black knight, ..., 11 for a white king
+    // and the row counts from white's side (row 0 is rank 1)
+    for (int sq = 0; sq < 64; sq++) {
+
+        Piece p = b.get(board64[sq]);
+
+        if (p.is_piece()) {
+            int kind = 2 * (p.type() - 1) + (p.color() == WHITE);
+            k ^= random64[64 * kind + 8 * (7 - sq / 8) + sq % 8];
+        }
+    }
+
+    // castling rights are in the same order as the castling bits
+    for (int i = 0; i < 4; i++) {
+        if (b.get_castle_rights() & (1 << i)) {
+            k ^= random64[768 + i];
+        }
+    }
+
+    // en passant only counts if a pawn of the side to play can capture
+    Byte ep = b.get_en_pass_sq();
+
+    if (ep) {
+
+        Piece pawn = Piece{s_Byte(PAWN | (b.get_turn() ? BLACK : WHITE))};
+        Byte behind = b.get_turn() ? ep - 10 : ep + 10;
+
+        if (b.get(behind - 1) == pawn || b.get(behind + 1) == pawn) {
+            k ^= random64[772 + board120[ep] % 8];
+        }
+    }
+
+    if (!b.get_turn()) {
+        k ^= random64[780];
+    }
+
+    return k;
+}
+
+vector<BookEntry> Book::find(Board& b) {
+
+    vector<BookEntry> found;
+
+    if (!is_open()) {
+        return found;
+    }
+
+    uint64_t k = key(b);
+
+    for (size_t i = lower_bound(k); i < entry_num && read_be(entries + i * 16, 8) == k; i++) {
+        found.push_back(entry(i));
+    }
+
+    return found;
+}
+
+bool Book::to_move(Board& b, uint16_t book_move, Move& move) {
+
+    int to_file = book_move & 7, to_row = book_move >> 3 & 7;
+    int from_file = book_move >> 6 & 7, from_row = book_move >> 9 & 7;
+    int promotion = book_move >> 12 & 7;
+
+    Byte start = board64[8 * (7 - from_row) + from_file];
+    Byte end = board64[8 * (7 - to_row) + to_file];
+
+    // castling is written as the king capturing its own rook
+    if (b.get(start).type() == KING && b.get(end).type() == ROOK && b.get(end).color() == b.get(start).color()) {
+        end = start + (end > start ? 2 : -2);
+    }
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    for (Move m : moves) {
+        if (m.start == start && m.end == end
+            && (promotion ? m.flag == KNIGHT_PROMO + promotion - 1 : m.flag < KNIGHT_PROMO || m.flag > QUEEN_PROMO)) {
+            move = m;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Book::probe(Board& b, Move& move) {
+
+    vector<BookEntry> found = find(b);
+
+    uint32_t total = 0;
+    for (BookEntry& e : found) {
+        total += e.weight;
+    }
+
+    if (!total) {
+        return false;
+    }
+
+    // xorshift64
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+
+    uint32_t pick = rng % total;
+
+    for (BookEntry& e : found) {
+
+        if (pick < e.weight) {
+            return to_move(b, e.move, move);
+        }
+
+        pick -= e.weight;
+    }
+
+    return false;
+}
@@ -0,0 +1,60 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "board.hpp"
+#include "mapped_file.hpp"
+#include "polyglot_keys.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*  polyglot opening books: a .bin file of 16 byte entries (key, move, weight, learn; big endian) sorted by key.
+    the key of a position is polyglot's own zobrist key (not Board::get_key), built from 781 random numbers:
+    768 for the pieces, 4 for the castling rights, 8 for the en passant file and 1 for white to play.
+    see http://hgm.nubati.net/book_format.html
+
+    the random numbers are polyglot's Random64 array (polyglot_keys.hpp), other numbers can be loaded from a text
+    file with 781 hexadecimal numbers (separated by white space or commas). the book file is memory mapped and entries
+    are found by binary search, so a probe doesn't read the file.
+*/
+
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;      // to file (3 bits) | to row (3) | from file (3) | from row (3) | promotion (3)
+    uint16_t weight;
+    uint32_t learn;
+};
+
+class Book {
+    private:
+        uint64_t random64[POLYGLOT_KEYS];
+        unique_ptr<MappedFile> file;
+        const unsigned char* entries = nullptr;
+        size_t entry_num = 0;
+        uint64_t rng = 0x9E3779B97F4A7C15ULL;      // state for the weighted random choice
+
+        BookEntry entry(size_t i);
+        size_t lower_bound(uint64_t key);
+    public:
+        Book();
+
+        // replace the random numbers, they are kept if the file doesn't have 781 numbers
+        bool load_keys(const char* path);
+        bool open(const char* path);
+        bool is_open() { return entries != nullptr; }
+        size_t size() { return entry_num; }
+        void seed(uint64_t s) { rng = s; }
+
+        uint64_t key(Board& b);
+
+        // all entries of the position
+        vector<BookEntry> find(Board& b);
+
+        // translate a polyglot move to the legal move of the position, returns false if it isn't legal
+        bool to_move(Board& b, uint16_t book_move, Move& move);
+
+        // pick a legal book move with probability proportional to its weight, returns false if there is none
+        bool probe(Board& b, Move& move);
+};
+
+#endif //BOOK_H
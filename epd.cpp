@@ -0,0 +1,70 @@
+#include "epd.hpp"
+#include "mapped_file.hpp"
+#include <chrono>
+
+using namespace std;
+
+EpdStats parse_epd(string_view text, Board& b) {
+
+    EpdStats stats;
+    stats.bytes = text.size();
+
+    auto start = chrono::steady_clock::now();
+
+    while (!text.empty()) {
+
+        size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        FenError error = b.set_fen(line);
+
+        if (error == FEN_OK) {
+            stats.positions++;
+        } else {
+            stats.errors[error]++;
+        }
+    }
+
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return stats;
+}
+
+bool epd_report(const char* path, ostream& os) {
+
+    MappedFile file(path);
+
+    if (!file.is_open()) {
+        os << "can't read " << path << endl;
+        return false;
+    }
+
+    Board b;
+    EpdStats stats = parse_epd(file.view(), b);
+
+    uint64_t total = stats.positions;
+    for (int i = 1; i < 7; i++) {
+        total += stats.errors[i];
+    }
+
+    os << "positions " << stats.positions << "\tlines " << total << "\ttime " << int(stats.seconds * 1000) << " ms"
+       << "\tpositions/s " << uint64_t(total / max(stats.seconds, 1e-9))
+       << "\tMB/s " << stats.bytes / max(stats.seconds, 1e-9) / (1024 * 1024) << endl;
+
+    for (int i = 1; i < 7; i++) {
+        if (stats.errors[i]) {
+            os << fen_error_str[i] << ": " << stats.errors[i] << endl;
+        }
+    }
+
+    return true;
+}
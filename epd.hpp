@@ -0,0 +1,26 @@
+#ifndef EPD_H
+#define EPD_H
+
+#include "board.hpp"
+#include <cstdint>
+
+/*  EPD files have one position per line: the first 4 (or all 6) fields of a FEN string,
+    followed by operations like "bm e4; id "test 1";" that are skipped here.
+    the file is memory mapped and every line is parsed into the same board, so nothing is allocated per position.
+    see https://www.chessprogramming.org/Extended_Position_Description
+*/
+
+struct EpdStats {
+    uint64_t positions = 0;         // lines parsed without error
+    uint64_t errors[7] = {0};       // lines with each FenError (errors[FEN_OK] is unused)
+    uint64_t bytes = 0;
+    double seconds = 0;
+};
+
+// parse all lines of an EPD text (empty lines and lines starting with # are skipped)
+EpdStats parse_epd(string_view text, Board& b);
+
+// parse an EPD file and print positions per second and the errors, returns false if the file can't be read
+bool epd_report(const char* path, ostream& os);
+
+#endif //EPD_H
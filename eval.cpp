@@ -0,0 +1,15 @@
+#include "eval.hpp"
+
+using namespace std;
+
+// material and piece-square tables, blended between middlegame and endgame by the phase
+// the sums are kept up to date by Board, so this doesn't look at the pieces
+int evaluate(Board& b) {
+
+    int phase = min(b.get_phase(), MAX_PHASE);
+    Score s = b.get_psqt();
+
+    int score = (s.mg * phase + s.eg * (MAX_PHASE - phase)) / MAX_PHASE;
+
+    return b.get_turn() ? -score : score;
+}
@@ -0,0 +1,11 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "board.hpp"
+
+const int piece_value[7] = {0, 100, 320, 330, 500, 900, 0};    // indexed by piece type, used for move ordering and exchanges
+
+// static evaluation in centipawns, from the point of view of the side to play
+int evaluate(Board& b);
+
+#endif //EVAL_H
@@ -1,24 +1,194 @@
 #include "board.hpp"
+#include "perft.hpp"
+#include "search.hpp"
+#include "uci.hpp"
+#include "epd.hpp"
+#include "bitbase.hpp"
+#include "match.hpp"
+#include "pgn.hpp"
+#include "training.hpp"
+#include "stats.hpp"
 #include <stdlib.h>
+#include <thread>
 
 using namespace std;
 
-int main() {
+/*  perft and search modes print the hot path counters afterwards when built with -DSTATS (see stats.hpp)
 
-    Board b;
-    cout << b << endl;
+    usage:
+        ./a.out                             uci mode, reads commands from stdin
+        ./a.out board                       print the starting position and the moves of every piece
+        ./a.out perft <depth> [fen]         count leaf nodes to given depth
+        ./a.out divide <depth> [fen]        perft with node counts per root move
+        ./a.out perftsuite [maxdepth]       check perft counts of the reference positions
+        ./a.out perftmt <depth> [threads] [hash MB] [fen]
+                                            parallel perft, prints node counts per thread
+        ./a.out search <depth> [fen] [threads]
+                                            search position to given depth and print the best move
+        ./a.out smpbench <depth> [max threads] [fen]
+                                            time to depth and nps of the search with 1 to max threads
+        ./a.out epd <file>                  parse every position of an EPD file, prints positions per second
+        ./a.out bitbases <file> [threads]   generate the KPK, KRK, KQK and KBNK bitbases and write them to a file
+        ./a.out match <epd file> [max games] [threads] [nodes A] [nodes B] [results file]
+                                            self-play match between two node limits, stopped by a sprt (elo 0 against 5)
+        ./a.out pgn <file> [threads]        replay every game of a PGN file, prints games per second
+        ./a.out selfplay <epd file> <record file> [games] [threads] [nodes]
+                                            append a training record of every position of self-play games to the file
+        ./a.out pgnrecords <pgn file> <record file> [threads] [nodes]
+                                            append a training record of every position of the PGN games with a result
+        ./a.out records <file>              unpack every record of a training record file, prints records per second
+*/
 
-    for (char sq = 21; sq < 99; sq++) {
-        if (b.get(sq).val > 0) {
-            
-            cout << piece2letter[b.get(sq).val] << '\t';
+int main(int argc, char* argv[]) {
 
-            vector<Move> moves = b.possible_moves(sq);
-            for (int i = 0; i < moves.size(); i++) {
-                cout << (int)moves[i].end << ' ';
-            }
+    string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "perft" || mode == "divide") {
+
+        int depth = argc > 2 ? atoi(argv[2]) : 1;
+        Board b(argc > 3 ? argv[3] : FEN_START);
+
+        perft_report(b, depth, mode == "divide", cout);
+        stats_report(cout);
+        return 0;
+    }
+
+    if (mode == "perftsuite") {
+
+        int maxdepth = argc > 2 ? atoi(argv[2]) : 4;
+        bool passed = perft_suite(maxdepth, cout);
+
+        stats_report(cout);
+        return passed ? 0 : 1;
+    }
+
+    if (mode == "perftmt") {
+
+        int depth = argc > 2 ? atoi(argv[2]) : 1;
+        int threads = argc > 3 ? atoi(argv[3]) : thread::hardware_concurrency();
+        size_t hash_mb = argc > 4 ? atoi(argv[4]) : 0;
+        Board b(argc > 5 ? argv[5] : FEN_START);
+
+        perft_parallel_report(b, depth, threads, hash_mb, cout);
+        stats_report(cout);
+        return 0;
+    }
+
+    if (mode == "search") {
+
+        SearchLimits limits;
+        limits.depth = argc > 2 ? atoi(argv[2]) : 8;
+
+        Board b(argc > 3 ? argv[3] : FEN_START);
+        TranspositionTable tt(64);
+        SmpSearch search(tt, argc > 4 ? atoi(argv[4]) : 1);
 
-            cout << endl;
+        search.on_iteration = [](const SearchInfo& info) { print_info(info, cout); };
+        SearchInfo result = search.run(b, limits);
+
+        cout << "bestmove " << (result.pv.empty() ? "(none)" : move2str(result.pv[0])) << endl;
+        stats_report(cout);
+        return 0;
+    }
+
+    if (mode == "smpbench") {
+
+        int depth = argc > 2 ? atoi(argv[2]) : 8;
+        int max_threads = argc > 3 ? atoi(argv[3]) : thread::hardware_concurrency();
+        Board b(argc > 4 ? argv[4] : FEN_START);
+
+        smp_benchmark(b, depth, max_threads, 64, cout);
+        return 0;
+    }
+
+    if (mode == "epd" && argc > 2) {
+        return epd_report(argv[2], cout) ? 0 : 1;
+    }
+
+    if (mode == "bitbases" && argc > 2) {
+
+        int threads = argc > 3 ? atoi(argv[3]) : thread::hardware_concurrency();
+
+        for (Endgame e : {KQK, KRK, KPK, KBNK}) {
+
+            auto start = chrono::steady_clock::now();
+            bitbases[e].generate(threads);
+
+            cout << endgame_str[e] << "\t" << bitbases[e].positions() << " positions\t"
+                 << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << " ms" << endl;
         }
+
+        return save_bitbases(argv[2]) ? 0 : 1;
     }
-}
\ No newline at end of file
+
+    if (mode == "match" && argc > 2) {
+
+        MatchSettings settings;
+        settings.max_games = argc > 3 ? atoi(argv[3]) : 1000;
+        settings.threads = argc > 4 ? atoi(argv[4]) : thread::hardware_concurrency();
+        settings.limits[0].nodes = argc > 5 ? atoi(argv[5]) : 10000;
+        settings.limits[1].nodes = argc > 6 ? atoi(argv[6]) : 10000;
+
+        return match_report(argv[2], settings, argc > 7 ? argv[7] : "match.txt", cout) ? 0 : 1;
+    }
+
+    if (mode == "pgn" && argc > 2) {
+
+        int threads = argc > 3 ? atoi(argv[3]) : thread::hardware_concurrency();
+
+        return pgn_report(argv[2], threads, cout) ? 0 : 1;
+    }
+
+    if (mode == "selfplay" && argc > 3) {
+
+        MatchSettings settings;
+        settings.max_games = argc > 4 ? atoi(argv[4]) : 100;
+        settings.threads = argc > 5 ? atoi(argv[5]) : thread::hardware_concurrency();
+        settings.limits[0].nodes = argc > 6 ? atoi(argv[6]) : 5000;
+
+        return selfplay_report(argv[2], argv[3], settings, cout) ? 0 : 1;
+    }
+
+    if (mode == "pgnrecords" && argc > 3) {
+
+        int threads = argc > 4 ? atoi(argv[4]) : thread::hardware_concurrency();
+        SearchLimits limits;
+        limits.nodes = argc > 5 ? atoi(argv[5]) : 5000;
+
+        return pgn_records_report(argv[2], argv[3], limits, threads, cout) ? 0 : 1;
+    }
+
+    if (mode == "records" && argc > 2) {
+        return records_report(argv[2], cout) ? 0 : 1;
+    }
+
+    if (mode == "board") {
+
+        Board b;
+        cout << b << endl;
+
+        for (s_Byte color : {WHITE, BLACK}) {
+            for (s_Byte type = PAWN; type <= KING; type++) {
+
+                Piece piece = Piece{s_Byte(type | color)};
+
+                for (int i = 0; i < b.count(piece); i++) {
+
+                    cout << piece2letter[piece.val] << '\t';
+
+                    vector<Move> moves = b.possible_moves(b.squares(piece)[i]);
+                    for (int j = 0; j < moves.size(); j++) {
+                        cout << (int)moves[j].end << ' ';
+                    }
+
+                    cout << endl;
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    Uci uci(cout);
+    uci.loop(cin);
+}
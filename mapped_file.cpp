@@ -0,0 +1,46 @@
+#include "mapped_file.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedFile::MappedFile(const char* path) {
+
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0) {
+
+        length = st.st_size;
+
+        // an empty file can't be mapped, but is still a valid (empty) file
+        if (length == 0) {
+            opened = true;
+        } else {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (p != MAP_FAILED) {
+                madvise(p, length, MADV_SEQUENTIAL);
+                data = (const char*)p;
+                opened = true;
+            } else {
+                length = 0;
+            }
+        }
+    }
+
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data) {
+        munmap((void*)data, length);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string_view>
+
+/*  read only memory mapped file, for reading large position files without copying them.
+    the data stays valid while the object lives.
+*/
+
+class MappedFile {
+    private:
+        const char* data = nullptr;
+        size_t length = 0;
+        bool opened = false;
+    public:
+        explicit MappedFile(const char* path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool is_open() { return opened; }
+        std::string_view view() { return std::string_view(data, length); }
+};
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,236 @@
+#include "match.hpp"
+#include "mapped_file.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+// expected score of a player that is elo stronger
+static double elo_to_score(double elo) {
+    return 1 / (1 + pow(10, -elo / 400));
+}
+
+double sprt_llr(int wins, int draws, int losses, double elo0, double elo1) {
+
+    double n = wins + draws + losses;
+
+    if (n == 0) {
+        return 0;
+    }
+
+    double score = (wins + draws / 2.0) / n;
+
+    // the variance is estimated with half a game of each result added, so it isn't 0 when all results are the same
+    double m = n + 1.5;
+    double mean = (wins + 0.5 + (draws + 0.5) / 2) / m;
+    double variance = (wins + 0.5 + (draws + 0.5) / 4) / m - mean * mean;
+
+    double s0 = elo_to_score(elo0);
+    double s1 = elo_to_score(elo1);
+
+    return (s1 - s0) * (2 * score - s0 - s1) / (2 * variance / n);
+}
+
+GameRecord play_game(const string& fen, bool a_white, const MatchSettings& settings, TranspositionTable tts[2],
+                     const function<void(Board&, const SearchInfo&)>& on_search) {
+
+    GameRecord record;
+    record.a_white = a_white;
+
+    Board b(fen);
+    MoveList moves;
+
+    tts[0].clear();
+    tts[1].clear();
+
+    while (true) {
+
+        b.generate_moves(moves);
+
+        if (!moves.size) {
+            record.end = b.in_check() ? END_MATE : END_STALEMATE;
+            record.score = b.in_check() ? (b.get_turn() ? 2 : 0) : 1;
+            break;
+        }
+
+        if (b.get_halfmove() >= 100) {
+            record.end = END_FIFTY_MOVES;
+            break;
+        }
+
+        if (b.is_repetition(2)) {
+            record.end = END_REPETITION;
+            break;
+        }
+
+        // the search makes its moves on a copy of the board, it must have room for them
+        if (record.plies >= MAX_HISTORY - MAX_PLY) {
+            record.end = END_LENGTH;
+            break;
+        }
+
+        int player = b.get_turn() == a_white;     // 0 -> A to play
+
+        auto search = make_unique<Search>(b, tts[player]);
+        SearchInfo info = search->run(settings.limits[player]);
+
+        if (on_search) {
+            on_search(b, info);
+        }
+
+        b.make_move(info.pv.empty() ? moves[0] : info.pv[0], false);
+        record.plies++;
+    }
+
+    return record;
+}
+
+MatchResult run_match(const vector<string>& openings, const MatchSettings& settings, ostream& results, ostream& os) {
+
+    MatchResult result;
+    mutex result_lock;
+
+    atomic<int> next_game{0};
+    atomic<bool> stopped{false};
+
+    double lower = log(settings.beta / (1 - settings.alpha));
+    double upper = log((1 - settings.beta) / settings.alpha);
+
+    auto start = chrono::steady_clock::now();
+
+    // every thread plays games until all are taken or the test is decided
+    auto worker = [&]() {
+
+        TranspositionTable tts[2] = {TranspositionTable(settings.hash_mb, false), TranspositionTable(settings.hash_mb, false)};
+
+        while (!stopped) {
+
+            int game = next_game++;
+
+            if (game >= settings.max_games) {
+                break;
+            }
+
+            // the two games of an opening have the colors swapped, the openings start over when there are more games
+            int opening = (game / 2) % openings.size();
+            GameRecord record = play_game(openings[opening], game % 2 == 0, settings, tts);
+            record.game = game;
+            record.opening = opening;
+
+            lock_guard<mutex> lock(result_lock);
+
+            if (stopped) {      // the test was decided while this game was played
+                break;
+            }
+
+            int a_score = record.a_white ? record.score : 2 - record.score;
+
+            result.wins += a_score == 2;
+            result.draws += a_score == 1;
+            result.losses += a_score == 0;
+            result.llr = sprt_llr(result.wins, result.draws, result.losses, settings.elo0, settings.elo1);
+            result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            results << record.game << " " << record.opening << " " << (record.a_white ? "A" : "B") << " "
+                    << (record.score == 2 ? "1-0" : record.score == 0 ? "0-1" : "1/2-1/2") << " "
+                    << record.plies << " " << game_end_str[record.end] << "\n";
+
+            if (result.llr <= lower || result.llr >= upper) {
+                result.sprt = result.llr >= upper ? 1 : -1;
+                stopped = true;
+            }
+
+            int played = result.wins + result.draws + result.losses;
+
+            if (played % 10 == 0 || stopped) {
+                os << "games " << played << "\t+" << result.wins << " =" << result.draws << " -" << result.losses
+                   << "\tllr " << result.llr << " (" << lower << ", " << upper << ")"
+                   << "\tgames/s " << played / max(result.seconds, 1e-9) << endl;
+            }
+        }
+    };
+
+    vector<thread> threads;
+
+    for (int i = 0; i < max(settings.threads, 1); i++) {
+        threads.emplace_back(worker);
+    }
+
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return result;
+}
+
+vector<string> read_openings(string_view text) {
+
+    vector<string> openings;
+    Board b;
+
+    while (!text.empty()) {
+
+        size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+
+        if (!line.empty() && line[0] != '#' && b.set_fen(line) == FEN_OK) {
+            openings.push_back(b.to_fen());
+        }
+    }
+
+    return openings;
+}
+
+bool match_report(const char* epd_path, const MatchSettings& settings, const char* results_path, ostream& os) {
+
+    MappedFile file(epd_path);
+
+    if (!file.is_open()) {
+        os << "can't read " << epd_path << endl;
+        return false;
+    }
+
+    vector<string> openings = read_openings(file.view());
+
+    if (openings.empty()) {
+        os << "no positions in " << epd_path << endl;
+        return false;
+    }
+
+    ofstream results(results_path);
+
+    if (!results) {
+        os << "can't write " << results_path << endl;
+        return false;
+    }
+
+    MatchResult r = run_match(openings, settings, results, os);
+
+    int games = r.wins + r.draws + r.losses;
+    double score = games ? (r.wins + r.draws / 2.0) / games : 0.5;
+    double elo = score > 0 && score < 1 ? 400 * log10(score / (1 - score)) : score ? 999 : -999;
+
+    os << "games " << games << "\t+" << r.wins << " =" << r.draws << " -" << r.losses
+       << "\tscore " << score << "\telo " << elo
+       << "\tsprt [" << settings.elo0 << ", " << settings.elo1 << "] "
+       << (r.sprt > 0 ? "H1 accepted" : r.sprt < 0 ? "H0 accepted" : "undecided")
+       << "\ttime " << int(r.seconds * 1000) << " ms\tgames/s " << games / max(r.seconds, 1e-9) << endl;
+
+    results << "# A " << settings.limits[0].nodes << " nodes depth " << settings.limits[0].depth
+            << ", B " << settings.limits[1].nodes << " nodes depth " << settings.limits[1].depth
+            << ": +" << r.wins << " =" << r.draws << " -" << r.losses << " llr " << r.llr << "\n";
+
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include "board.hpp"
+#include "search.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+/*  engine vs engine matches between two players A and B with their own search limits (node count or depth).
+    every opening of an EPD file is played twice with the colors swapped, and the openings are played again from
+    the first one until the maximum number of games. the games run concurrently, one per thread, with their own
+    board and transposition tables. a game ends by mate, stalemate, the fifty move rule or threefold repetition
+    (and games longer than the board history are drawn).
+
+    the match stops when a sequential probability ratio test accepts one of the hypotheses
+    "A is elo0 stronger than B" or "A is elo1 stronger than B", or after the maximum number of games.
+    see https://www.chessprogramming.org/Sequential_Probability_Ratio_Test
+*/
+
+struct MatchSettings {
+    SearchLimits limits[2];         // player A, player B
+    size_t hash_mb = 4;             // per player and game
+    int threads = 1;                // games played at the same time
+    int max_games = 1000;
+    double elo0 = 0;                // sprt hypotheses
+    double elo1 = 5;
+    double alpha = 0.05;            // probability to accept elo1 if elo0 is true
+    double beta = 0.05;             // probability to accept elo0 if elo1 is true
+};
+
+enum GameEnd {
+    END_MATE,
+    END_STALEMATE,
+    END_FIFTY_MOVES,
+    END_REPETITION,
+    END_LENGTH
+};
+
+const char* const game_end_str[] = {"mate", "stalemate", "fifty", "repetition", "length"};
+
+struct GameRecord {
+    int game = 0;
+    int opening = 0;
+    bool a_white = true;
+    int score = 1;                  // 2 -> white wins, 1 -> draw, 0 -> black wins
+    int plies = 0;
+    GameEnd end = END_MATE;
+};
+
+struct MatchResult {
+    int wins = 0;                   // from A's point of view
+    int draws = 0;
+    int losses = 0;
+    double llr = 0;
+    int sprt = 0;                   // 1 -> elo1 accepted, -1 -> elo0 accepted, 0 -> undecided
+    double seconds = 0;
+};
+
+// log likelihood ratio of elo1 against elo0 for the results (normal approximation of the trinomial model)
+double sprt_llr(int wins, int draws, int losses, double elo0, double elo1);
+
+// play one game from the opening position, the tables are cleared first
+// on_search is called with the position and the result of every search, before the move is made
+GameRecord play_game(const string& fen, bool a_white, const MatchSettings& settings, TranspositionTable tts[2],
+                     const function<void(Board&, const SearchInfo&)>& on_search = nullptr);
+
+// play the match, one line per game is written to results:
+// <game> <opening> <white player> <result> <plies> <reason>, like "12 5 B 1/2-1/2 87 repetition"
+MatchResult run_match(const vector<string>& openings, const MatchSettings& settings, ostream& results, ostream& os);
+
+// positions of the lines of an EPD text, lines that aren't valid positions are skipped
+vector<string> read_openings(string_view text);
+
+// read the openings from an EPD file and play the match, prints the progress and a summary to os
+bool match_report(const char* epd_path, const MatchSettings& settings, const char* results_path, ostream& os);
+
+#endif //MATCH_H
@@ -0,0 +1,174 @@
+#include "movepick.hpp"
+#include "eval.hpp"
+#include "tt.hpp"
+#include <algorithm>
+
+using namespace std;
+
+static const Move NO_MOVE(0, 0, EMPTY);
+
+MovePicker::MovePicker(Board& b, uint16_t packed_hash_move, const Move killers[2], const int history[15][64])
+    : board(b), captures_only(false), hash_move(NO_MOVE), killers{killers[0], killers[1]}, history(history) {
+
+    // the table move can come from another position with the same index (or a key collision)
+    if (packed_hash_move) {
+        Move m = unpack_move(packed_hash_move, b);
+
+        if (b.is_legal(m)) {
+            hash_move = m;
+        }
+    }
+}
+
+MovePicker::MovePicker(Board& b)
+    : board(b), stage(STAGE_CAPTURES_INIT), captures_only(true), hash_move(NO_MOVE), killers{NO_MOVE, NO_MOVE}, history(nullptr) {}
+
+// most valuable victim / least valuable attacker, a promotion adds the value of the new piece
+// underpromotions are scored below 0 (they are tried with the bad captures)
+void MovePicker::score_captures() {
+
+    for (int i = 0; i < moves.size; i++) {
+
+        Move m = moves[i];
+        Byte attacker = board.get(m.start).type();
+        Byte victim = m.flag == EN_PASSANT ? PAWN : m.captured.is_piece() ? m.captured.type() : 0;
+        bool promotion = m.flag >= KNIGHT_PROMO && m.flag <= QUEEN_PROMO;
+
+        scores[i] = (piece_value[victim] + (promotion ? piece_value[m.flag] : 0)) * 8 - attacker;
+
+        if (!captures_only && promotion && m.flag != QUEEN_PROMO) {
+            scores[i] -= 1 << 16;
+        }
+    }
+}
+
+// by history of the piece on the target square
+void MovePicker::score_quiets() {
+
+    for (int i = 0; i < moves.size; i++) {
+        Move m = moves[i];
+        scores[i] = history[board.get(m.start).val][board120[m.end]];
+    }
+}
+
+// selection sort step: the highest scored remaining move
+bool MovePicker::pick(Move& m) {
+
+    if (current == moves.size) {
+        return false;
+    }
+
+    int best = current;
+
+    for (int j = current + 1; j < moves.size; j++) {
+        if (scores[j] > scores[best]) {
+            best = j;
+        }
+    }
+
+    swap(moves[current], moves[best]);
+    swap(scores[current], scores[best]);
+
+    m = moves[current++];
+    return true;
+}
+
+bool MovePicker::next(Move& m) {
+
+    switch (stage) {
+
+        case STAGE_HASH:
+            stage = STAGE_CAPTURES_INIT;
+
+            if (hash_move.start != hash_move.end) {
+                m = hash_move;
+                return true;
+            }
+            [[fallthrough]];
+
+        case STAGE_CAPTURES_INIT:
+            board.generate_moves(moves, GEN_CAPTURES);
+            score_captures();
+            current = 0;
+            stage = STAGE_GOOD_CAPTURES;
+            [[fallthrough]];
+
+        case STAGE_GOOD_CAPTURES:
+            while (pick(m)) {
+
+                if (captures_only) {
+                    if (m.flag >= KNIGHT_PROMO && m.flag < QUEEN_PROMO) {
+                        continue;
+                    }
+                    return true;
+                }
+
+                if (same_move(m, hash_move)) {
+                    continue;
+                }
+
+                // the exchange is only evaluated for the captures that are actually picked
+                if (scores[current - 1] < 0 || !board.see_ge(m, 0)) {
+                    bad_captures[bad_num++] = m;
+                    continue;
+                }
+
+                return true;
+            }
+
+            if (captures_only) {
+                stage = STAGE_DONE;
+                return false;
+            }
+
+            stage = STAGE_KILLERS;
+            [[fallthrough]];
+
+        case STAGE_KILLERS:
+            // the killers come from other positions, a killer that is a capture here was already picked
+            while (killer_index < 2) {
+
+                Move killer = killers[killer_index++];
+
+                if (killer.start != killer.end && !is_tactical(killer) && !same_move(killer, hash_move)
+                    && !(killer_index == 2 && same_move(killer, killers[0])) && board.is_legal(killer)) {
+                    m = killer;
+                    return true;
+                }
+            }
+
+            stage = STAGE_QUIETS_INIT;
+            [[fallthrough]];
+
+        case STAGE_QUIETS_INIT:
+            board.generate_moves(moves, GEN_QUIETS);
+            score_quiets();
+            current = 0;
+            stage = STAGE_QUIETS;
+            [[fallthrough]];
+
+        case STAGE_QUIETS:
+            while (pick(m)) {
+                if (!same_move(m, hash_move) && !same_move(m, killers[0]) && !same_move(m, killers[1])) {
+                    return true;
+                }
+            }
+
+            stage = STAGE_BAD_CAPTURES;
+            [[fallthrough]];
+
+        case STAGE_BAD_CAPTURES:
+            if (bad_current < bad_num) {
+                m = bad_captures[bad_current++];
+                return true;
+            }
+
+            stage = STAGE_DONE;
+            [[fallthrough]];
+
+        case STAGE_DONE:
+            return false;
+    }
+
+    return false;
+}
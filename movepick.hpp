@@ -0,0 +1,71 @@
+#ifndef MOVEPICK_H
+#define MOVEPICK_H
+
+#include "board.hpp"
+#include <cstdint>
+
+/*  staged move generation: the moves of a node are handed out one at a time, best first, and the moves of a stage
+    are only generated when the earlier stages didn't cause a cutoff. most cutoffs come from the hash move or a
+    capture, so the quiet moves often don't have to be generated at all.
+
+    1. hash move from the transposition table (checked to be legal in this position, it is not generated)
+    2. good captures and queen promotions, most valuable victim / least valuable attacker first
+    3. killers: quiet moves that caused a cutoff at the same ply in another branch (checked to be legal, not generated)
+    4. the other quiet moves, ordered by the history of cutoffs of the piece on the target square
+    5. bad captures (losing material by static exchange evaluation) and underpromotions
+
+    in the captures only mode of the quiescence search there is only stage 2, with the bad captures included
+    and without underpromotions (the quiescence search prunes the bad captures itself).
+    see https://www.chessprogramming.org/Move_Generation#Staged_Move_Generation
+*/
+
+enum Stage {
+    STAGE_HASH,
+    STAGE_CAPTURES_INIT,
+    STAGE_GOOD_CAPTURES,
+    STAGE_KILLERS,
+    STAGE_QUIETS_INIT,
+    STAGE_QUIETS,
+    STAGE_BAD_CAPTURES,
+    STAGE_DONE
+};
+
+const int HISTORY_MAX = 1 << 16;        // the history table is halved when an entry gets larger
+
+inline bool same_move(Move a, Move b) {
+    return a.start == b.start && a.end == b.end && a.flag == b.flag;
+}
+
+class MovePicker {
+    private:
+        Board& board;
+        Stage stage = STAGE_HASH;
+        bool captures_only;
+        Move hash_move;                     // start == end -> no hash move
+        Move killers[2];
+        int killer_index = 0;               // next killer of the killers stage
+        const int (*history)[64];           // [Piece::val][square index of board64]
+
+        MoveList moves;                     // moves of the current stage
+        int scores[MAX_MOVES];
+        int current = 0;
+
+        Move bad_captures[MAX_MOVES];       // captures put aside in stage 2
+        int bad_num = 0;
+        int bad_current = 0;
+
+        void score_captures();
+        void score_quiets();
+        bool pick(Move& m);
+    public:
+        // main search: packed hash move (0 -> none), killers of the ply and history table of the search
+        MovePicker(Board& b, uint16_t packed_hash_move, const Move killers[2], const int history[15][64]);
+
+        // quiescence search: captures and queen promotions only
+        explicit MovePicker(Board& b);
+
+        // next legal move, returns false when all moves were picked
+        bool next(Move& m);
+};
+
+#endif //MOVEPICK_H
@@ -0,0 +1,369 @@
+#include "perft.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+// reference positions from https://www.chessprogramming.org/Perft_Results
+const PerftPosition perft_positions[] = {
+    {"start", FEN_START,
+        {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        {48, 2039, 97862, 4085603, 193690690, 0}},
+    {"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        {14, 191, 2812, 43238, 674624, 11030083}},
+    {"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        {6, 264, 9467, 422333, 15833292, 0}},
+    {"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        {44, 1486, 62379, 2103487, 89941194, 0}},
+    {"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        {46, 2079, 89890, 3894594, 164075551, 0}}
+};
+
+const int perft_positions_num = sizeof(perft_positions) / sizeof(PerftPosition);
+
+
+// count leaf nodes of the legal move tree with given depth
+// the generated moves are legal, so the last ply is counted without making the moves (bulk counting)
+uint64_t perft(Board& b, int depth) {
+
+    if (depth == 0) {
+        return 1;
+    }
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    if (depth == 1) {
+        return moves.size;
+    }
+
+    uint64_t nodes = 0;
+
+    for (Move m : moves) {
+        b.make_move(m, false);
+        nodes += perft(b, depth - 1);
+        b.unmake_move(m);
+    }
+
+    return nodes;
+}
+
+// perft with the node count of every legal root move printed separately
+uint64_t divide(Board& b, int depth, ostream& os) {
+
+    uint64_t nodes = 0;
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    for (Move m : moves) {
+
+        b.make_move(m, false);
+
+        uint64_t move_nodes = depth > 1 ? perft(b, depth - 1) : 1;
+        os << move2str(m) << ": " << move_nodes << endl;
+        nodes += move_nodes;
+
+        b.unmake_move(m);
+    }
+
+    return nodes;
+}
+
+// run perft (or divide if split is set) and print node count, time and nodes per second
+void perft_report(Board& b, int depth, bool split, ostream& os) {
+
+    auto start = chrono::steady_clock::now();
+
+    uint64_t nodes = split ? divide(b, depth, os) : perft(b, depth);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (split) {
+        os << endl;
+    }
+
+    os << "depth " << depth << "\tnodes " << nodes << "\ttime " << (uint64_t)(seconds * 1000) << " ms"
+       << "\tnps " << (uint64_t)(seconds > 0 ? nodes / seconds : 0) << endl;
+}
+
+// run perft on all reference positions up to maxdepth and compare with the known node counts
+bool perft_suite(int maxdepth, ostream& os) {
+
+    bool all_correct = true;
+    uint64_t total_nodes = 0;
+    double total_seconds = 0;
+
+    for (int i = 0; i < perft_positions_num; i++) {
+
+        const PerftPosition& pos = perft_positions[i];
+        os << pos.name << "\t" << pos.fen << endl;
+
+        for (int depth = 1; depth <= maxdepth && depth <= 6 && pos.nodes[depth - 1]; depth++) {
+
+            Board b(pos.fen);
+
+            auto start = chrono::steady_clock::now();
+            uint64_t nodes = perft(b, depth);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            bool correct = nodes == pos.nodes[depth - 1];
+            all_correct = all_correct && correct;
+            total_nodes += nodes;
+            total_seconds += seconds;
+
+            os << "  depth " << depth << "\t" << nodes;
+            if (!correct) {
+                os << " (expected " << pos.nodes[depth - 1] << ")";
+            }
+            os << "\t" << (correct ? "OK" : "FAIL") << "\t" << (uint64_t)(seconds * 1000) << " ms" << endl;
+        }
+    }
+
+    os << endl << "total nodes " << total_nodes << "\ttime " << (uint64_t)(total_seconds * 1000) << " ms"
+       << "\tnps " << (uint64_t)(total_seconds > 0 ? total_nodes / total_seconds : 0) << endl;
+    os << "perft suite " << (all_correct ? "passed" : "failed") << endl;
+
+    return all_correct;
+}
+
+
+// lock-free cache of subtree node counts, an entry is (key of position and depth) ^ count and the count
+class PerftHash {
+    private:
+        struct Entry {
+            std::atomic<uint64_t> check;
+            std::atomic<uint64_t> nodes;
+        };
+
+        unique_ptr<Entry[]> entries;
+        size_t mask;
+
+        // different depths of the same position get different keys
+        static uint64_t depth_key(uint64_t key, int depth) { return key ^ (depth * 0x9E3779B97F4A7C15ULL); }
+    public:
+        explicit PerftHash(size_t mb) {
+
+            size_t size = 1;
+            while (size * 2 * sizeof(Entry) <= mb * 1024 * 1024) {
+                size *= 2;
+            }
+
+            entries.reset(new Entry[size]());
+            mask = size - 1;
+        }
+
+        bool probe(uint64_t key, int depth, uint64_t& nodes) {
+
+            uint64_t k = depth_key(key, depth);
+            Entry& e = entries[k & mask];
+
+            uint64_t n = e.nodes.load(memory_order_relaxed);
+
+            if ((e.check.load(memory_order_relaxed) ^ n) == k && n) {
+                nodes = n;
+                return true;
+            }
+
+            return false;
+        }
+
+        void store(uint64_t key, int depth, uint64_t nodes) {
+
+            uint64_t k = depth_key(key, depth);
+            Entry& e = entries[k & mask];
+
+            e.nodes.store(nodes, memory_order_relaxed);
+            e.check.store(k ^ nodes, memory_order_relaxed);
+        }
+};
+
+// perft with subtree counts cached in the hash table
+static uint64_t perft_hashed(Board& b, int depth, PerftHash& hash) {
+
+    if (depth <= 1) {
+        return perft(b, depth);
+    }
+
+    uint64_t nodes = 0;
+
+    if (hash.probe(b.get_key(), depth, nodes)) {
+        return nodes;
+    }
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    for (Move m : moves) {
+
+        b.make_move(m, false);
+        nodes += perft_hashed(b, depth - 1, hash);
+        b.unmake_move(m);
+    }
+
+    hash.store(b.get_key(), depth, nodes);
+
+    return nodes;
+}
+
+
+const int MAX_SPLIT = 4;    // maximum number of plies a subtree can be below the root
+
+// subtree of the perft tree, the position after the moves in path from the root
+struct PerftTask {
+    Move path[MAX_SPLIT];
+    int length = 0;
+    int depth;
+};
+
+struct PerftQueue {
+    mutex lock;
+    deque<PerftTask> tasks;
+};
+
+// split the tree until there are enough subtrees to keep all threads busy until the end
+static vector<PerftTask> split_tree(Board& b, int depth, int threads) {
+
+    vector<PerftTask> tasks(1);
+    tasks[0].depth = depth;
+
+    while (tasks.size() < size_t(threads) * 8 && !tasks.empty() && tasks[0].depth > 2 && tasks[0].length < MAX_SPLIT) {
+
+        vector<PerftTask> children;
+
+        for (PerftTask& task : tasks) {
+
+            for (int i = 0; i < task.length; i++) {
+                b.make_move(task.path[i], false);
+            }
+
+            MoveList moves;
+            b.generate_moves(moves);
+
+            for (Move m : moves) {
+
+                PerftTask child = task;
+                child.path[child.length++] = m;
+                child.depth--;
+                children.push_back(child);
+            }
+
+            for (int i = task.length - 1; i >= 0; i--) {
+                b.unmake_move(task.path[i]);
+            }
+        }
+
+        tasks.swap(children);
+    }
+
+    return tasks;
+}
+
+// take a subtree from the back of the own queue, or else from the front of another queue
+static bool next_task(vector<PerftQueue>& queues, int id, PerftTask& task, PerftThreadStats& stats) {
+
+    for (size_t i = 0; i < queues.size(); i++) {
+
+        PerftQueue& q = queues[(id + i) % queues.size()];
+        lock_guard<mutex> guard(q.lock);
+
+        if (!q.tasks.empty()) {
+
+            if (i == 0) {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+            } else {
+                task = q.tasks.front();
+                q.tasks.pop_front();
+                stats.steals++;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint64_t perft_parallel(const Board& b, int depth, int threads, size_t hash_mb, vector<PerftThreadStats>& stats) {
+
+    threads = max(threads, 1);
+
+    Board root = b;
+    vector<PerftTask> tasks = split_tree(root, depth, threads);
+
+    // deal the subtrees out round robin
+    vector<PerftQueue> queues(threads);
+    for (size_t i = 0; i < tasks.size(); i++) {
+        queues[i % threads].tasks.push_back(tasks[i]);
+    }
+
+    unique_ptr<PerftHash> hash(hash_mb ? new PerftHash(hash_mb) : nullptr);
+    stats.assign(threads, PerftThreadStats());
+
+    auto worker = [&](int id) {
+
+        Board board = b;
+        PerftTask task;
+        PerftThreadStats& s = stats[id];
+        auto start = chrono::steady_clock::now();
+
+        while (next_task(queues, id, task, s)) {
+
+            for (int i = 0; i < task.length; i++) {
+                board.make_move(task.path[i], false);
+            }
+
+            s.nodes += hash ? perft_hashed(board, task.depth, *hash) : perft(board, task.depth);
+            s.tasks++;
+
+            for (int i = task.length - 1; i >= 0; i--) {
+                board.unmake_move(task.path[i]);
+            }
+        }
+
+        s.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    };
+
+    vector<thread> pool;
+    for (int i = 1; i < threads; i++) {
+        pool.emplace_back(worker, i);
+    }
+
+    worker(0);
+
+    for (thread& t : pool) {
+        t.join();
+    }
+
+    uint64_t nodes = 0;
+    for (PerftThreadStats& s : stats) {
+        nodes += s.nodes;
+    }
+
+    return nodes;
+}
+
+// run parallel perft and print total and per thread node counts, time and nodes per second
+void perft_parallel_report(Board& b, int depth, int threads, size_t hash_mb, ostream& os) {
+
+    vector<PerftThreadStats> stats;
+
+    auto start = chrono::steady_clock::now();
+    uint64_t nodes = perft_parallel(b, depth, threads, hash_mb, stats);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    for (size_t i = 0; i < stats.size(); i++) {
+        os << "thread " << i << "\tnodes " << stats[i].nodes << "\tsubtrees " << stats[i].tasks
+           << "\tstolen " << stats[i].steals << "\tbusy " << (uint64_t)(stats[i].seconds * 1000) << " ms" << endl;
+    }
+
+    os << "depth " << depth << "\tnodes " << nodes << "\ttime " << (uint64_t)(seconds * 1000) << " ms"
+       << "\tnps " << (uint64_t)(seconds > 0 ? nodes / seconds : 0) << "\tthreads " << stats.size()
+       << "\thash " << hash_mb << " MB" << endl;
+}
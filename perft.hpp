@@ -0,0 +1,47 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "board.hpp"
+#include <cstdint>
+
+/*  perft (performance test) walks the legal move tree to a fixed depth and counts the leaf nodes.
+    the counts are compared against known values to verify the move generator,
+    and the time it takes gives the raw speed of move generation + make/unmake.
+    see https://www.chessprogramming.org/Perft_Results
+*/
+
+struct PerftPosition {
+    const char* name;
+    const char* fen;
+    uint64_t nodes[6];      // known node counts for depth 1 to 6 (0 -> unknown)
+};
+
+extern const PerftPosition perft_positions[];
+extern const int perft_positions_num;
+
+uint64_t perft(Board& b, int depth);
+
+uint64_t divide(Board& b, int depth, ostream& os);
+
+void perft_report(Board& b, int depth, bool split, ostream& os);
+
+bool perft_suite(int maxdepth, ostream& os);
+
+/*  parallel perft: the tree is split into subtrees at the root (and deeper if there are too few root moves),
+    and the subtrees are searched by a pool of threads with one board copy each.
+    every thread has its own queue of subtrees, and takes subtrees from the other queues when its own is empty.
+    subtree counts can be cached in a shared lock-free hash table of (key, depth) -> node count.
+*/
+
+struct PerftThreadStats {
+    uint64_t nodes = 0;
+    int tasks = 0;      // subtrees searched
+    int steals = 0;     // subtrees taken from another thread
+    double seconds = 0; // busy time
+};
+
+uint64_t perft_parallel(const Board& b, int depth, int threads, size_t hash_mb, vector<PerftThreadStats>& stats);
+
+void perft_parallel_report(Board& b, int depth, int threads, size_t hash_mb, ostream& os);
+
+#endif //PERFT_H
@@ -0,0 +1,483 @@
+#include "pgn.hpp"
+#include "mapped_file.hpp"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+
+static bool is_promotion(Flag flag) {
+    return flag >= KNIGHT_PROMO && flag <= QUEEN_PROMO;
+}
+
+static char square_file(Byte square) {
+    return 'a' + board120[square] % 8;
+}
+
+static char square_rank(Byte square) {
+    return '8' - board120[square] / 8;
+}
+
+bool parse_san(Board& b, string_view san, Move& move) {
+
+    // check marks and annotations (e4+, Nf3!?)
+    while (!san.empty() && strchr("+#!?", san.back())) {
+        san.remove_suffix(1);
+    }
+
+    if (san.empty()) {
+        return false;
+    }
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+
+        bool queenside = san.size() == 5;
+
+        for (Move m : moves) {
+            if (m.flag == CASTLES && (m.end < m.start) == queenside) {
+                move = m;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    Byte type = PAWN;
+
+    if (strchr("NBRQK", san[0])) {
+        type = letter2piece[san[0]].type();
+        san.remove_prefix(1);
+    }
+
+    // promotion piece, e8=Q or e8Q
+    Flag promotion = NO_FLAG;
+
+    if (type == PAWN && san.size() > 2 && strchr("NBRQnbrq", san.back())) {
+        promotion = Flag(letter2piece[char(toupper(san.back()))].type());
+        san.remove_suffix(1);
+
+        if (san.back() == '=') {
+            san.remove_suffix(1);
+        }
+    }
+
+    if (san.size() < 2) {
+        return false;
+    }
+
+    char end_file = san[san.size() - 2];
+    char end_rank = san[san.size() - 1];
+
+    if (end_file < 'a' || end_file > 'h' || end_rank < '1' || end_rank > '8') {
+        return false;
+    }
+
+    Byte end = algebraic2int(end_file, end_rank);
+    san.remove_suffix(2);
+
+    if (!san.empty() && (san.back() == 'x' || san.back() == ':')) {
+        san.remove_suffix(1);
+    }
+
+    // what is left is the disambiguation, a file, a rank or both
+    char from_file = 0, from_rank = 0;
+
+    for (char c : san) {
+        if (c >= 'a' && c <= 'h') {
+            from_file = c;
+        } else if (c >= '1' && c <= '8') {
+            from_rank = c;
+        } else {
+            return false;
+        }
+    }
+
+    int found = 0;
+
+    for (Move m : moves) {
+
+        if (m.end != end || m.flag == CASTLES || b.get(m.start).type() != type) {
+            continue;
+        }
+
+        if (is_promotion(m.flag) ? m.flag != promotion : promotion != NO_FLAG) {
+            continue;
+        }
+
+        if ((from_file && square_file(m.start) != from_file) || (from_rank && square_rank(m.start) != from_rank)) {
+            continue;
+        }
+
+        move = m;
+        found++;
+    }
+
+    return found == 1;
+}
+
+string move2san(Board& b, Move m) {
+
+    string san;
+    Piece piece = b.get(m.start);
+
+    if (m.flag == CASTLES) {
+        san = m.end > m.start ? "O-O" : "O-O-O";
+    } else {
+
+        bool capture = m.captured.is_piece() || m.flag == EN_PASSANT;
+
+        if (piece.type() == PAWN) {
+            if (capture) {
+                san += square_file(m.start);
+            }
+        } else {
+
+            san += piece2letter[piece.type()];
+
+            // other pieces of the same kind that can go to the same square
+            MoveList moves;
+            b.generate_moves(moves);
+
+            bool ambiguous = false, same_file = false, same_rank = false;
+
+            for (Move other : moves) {
+                if (other.end == m.end && other.start != m.start && b.get(other.start) == piece) {
+                    ambiguous = true;
+                    same_file |= square_file(other.start) == square_file(m.start);
+                    same_rank |= square_rank(other.start) == square_rank(m.start);
+                }
+            }
+
+            if (ambiguous && (!same_file || same_rank)) {
+                san += square_file(m.start);
+            }
+
+            if (ambiguous && same_file) {
+                san += square_rank(m.start);
+            }
+        }
+
+        if (capture) {
+            san += 'x';
+        }
+
+        san += int2algebraic(m.end);
+
+        if (is_promotion(m.flag)) {
+            san += '=';
+            san += piece2letter[m.flag];
+        }
+    }
+
+    b.make_move(m, false);
+
+    if (b.in_check()) {
+        MoveList replies;
+        b.generate_moves(replies);
+        san += replies.size ? '+' : '#';
+    }
+
+    b.unmake_move(m);
+
+    return san;
+}
+
+string_view PgnGame::tag(string_view name) const {
+
+    for (auto& [tag_name, value] : tags) {
+        if (tag_name == name) {
+            return value;
+        }
+    }
+
+    return {};
+}
+
+bool PgnReader::next(PgnGame& game) {
+
+    game.tags.clear();
+    game.movetext = {};
+
+    auto skip_space = [&]() {
+        while (pos < text.size() && isspace((unsigned char)text[pos])) {
+            pos++;
+        }
+    };
+
+    skip_space();
+
+    if (pos >= text.size()) {
+        return false;
+    }
+
+    // tag pairs, one per line: [Name "value"]
+    while (pos < text.size() && text[pos] == '[') {
+
+        size_t end = min(text.find('\n', pos), text.size());
+        string_view line = text.substr(pos, end - pos);
+        pos = min(end + 1, text.size());
+
+        size_t name_end = line.find(' ');
+        size_t open = line.find('"');
+        size_t close = line.rfind('"');
+
+        if (name_end != string_view::npos && open != string_view::npos && close > open) {
+            game.tags.emplace_back(line.substr(1, name_end - 1), line.substr(open + 1, close - open - 1));
+        }
+
+        // a blank line ends the tags, the tags of a game without moves are not merged with the next game
+        size_t next = text.find_first_not_of(" \t\r", pos);
+
+        if (next == string_view::npos || text[next] == '\n') {
+            break;
+        }
+
+        skip_space();
+    }
+
+    // the moves go up to the next line that starts with a tag, brackets in comments don't count
+    size_t start = pos;
+    bool line_start = false;
+
+    while (pos < text.size()) {
+
+        char c = text[pos];
+
+        if (c == '[' && line_start) {
+            break;
+        }
+
+        if (c == '{') {
+            pos = min(text.find('}', pos), text.size());
+        } else if (c == ';') {
+            pos = min(text.find('\n', pos), text.size());
+            continue;
+        }
+
+        line_start = c == '\n';
+        pos++;
+    }
+
+    game.movetext = text.substr(start, min(pos, text.size()) - start);
+    pos = min(pos, text.size());
+
+    return true;
+}
+
+bool replay_game(const PgnGame& game, Board& b, const function<void(Board&, Move)>& on_move) {
+
+    string_view fen = game.tag("FEN");
+
+    if (b.set_fen(fen.empty() ? FEN_START : fen) != FEN_OK) {
+        return false;
+    }
+
+    string_view text = game.movetext;
+    size_t i = 0;
+    int variation = 0;      // depth of the variations, their moves are skipped
+    int plies = 0;
+
+    while (i < text.size()) {
+
+        char c = text[i];
+
+        if (isspace((unsigned char)c)) {
+            i++;
+            continue;
+        }
+
+        if (c == '{' || c == ';') {
+            i = text.find(c == '{' ? '}' : '\n', i);
+
+            if (i == string_view::npos) {
+                break;
+            }
+
+            i++;
+            continue;
+        }
+
+        if (c == '(' || c == ')') {
+            variation += c == '(' ? 1 : -1;
+            i++;
+            continue;
+        }
+
+        size_t end = i;
+
+        while (end < text.size() && !isspace((unsigned char)text[end]) && !strchr("{;()", text[end])) {
+            end++;
+        }
+
+        string_view token = text.substr(i, end - i);
+        i = end;
+
+        if (variation > 0 || token[0] == '$') {
+            continue;
+        }
+
+        if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+            break;
+        }
+
+        // move numbers, alone or in front of the move (12. 12... 12.e4)
+        size_t dot = token.rfind('.');
+
+        if (isdigit((unsigned char)token[0]) && dot != string_view::npos) {
+            token.remove_prefix(dot + 1);
+
+            if (token.empty()) {
+                continue;
+            }
+        }
+
+        Move m;
+
+        if (!parse_san(b, token, m)) {
+            return false;
+        }
+
+        if (on_move) {
+            on_move(b, m);
+        }
+
+        // very long games don't fit in the history, continue from the same position without it
+        if (++plies % (MAX_HISTORY - 1) == 0 && b.set_fen(b.to_fen()) != FEN_OK) {
+            return false;
+        }
+
+        b.make_move(m, false);
+    }
+
+    return true;
+}
+
+// a tag pair starts at pos: [Name "
+static bool is_tag(string_view text, size_t pos) {
+
+    size_t i = pos + 1;
+
+    while (i < text.size() && (isalnum((unsigned char)text[i]) || text[i] == '_')) {
+        i++;
+    }
+
+    return text[pos] == '[' && i > pos + 1 && text.substr(i, 2) == " \"";
+}
+
+vector<string_view> split_games(string_view text, int parts) {
+
+    vector<string_view> result;
+    size_t start = 0;
+
+    for (int i = 1; i <= parts && start < text.size(); i++) {
+
+        size_t end = text.size();
+
+        // the first tag of a game after the even split point: a tag at the start of a line after a line that isn't one
+        if (i < parts) {
+
+            end = text.size() * i / parts;
+
+            while (end < text.size()) {
+
+                end = text.find("\n[", max(end, start));
+
+                if (end == string_view::npos) {
+                    end = text.size();
+                    break;
+                }
+
+                size_t line = text.rfind('\n', end - 1);
+                line = line == string_view::npos ? 0 : line + 1;
+
+                if (end > start && is_tag(text, end + 1) && !is_tag(text, line)) {
+                    end++;
+                    break;
+                }
+
+                end++;
+            }
+        }
+
+        if (end > start) {
+            result.push_back(text.substr(start, end - start));
+        }
+
+        start = end;
+    }
+
+    return result;
+}
+
+PgnStats replay_pgn(string_view text, int threads) {
+
+    vector<string_view> parts = split_games(text, max(threads, 1));
+    vector<PgnStats> results(parts.size());
+    vector<thread> workers;
+
+    auto start = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < parts.size(); i++) {
+
+        workers.emplace_back([&, i]() {
+
+            Board b;
+            PgnReader reader(parts[i]);
+            PgnGame game;
+            PgnStats& r = results[i];
+
+            while (reader.next(game)) {
+
+                uint64_t moves = 0;
+
+                if (replay_game(game, b, [&](Board&, Move) { moves++; })) {
+                    r.games++;
+                } else {
+                    r.errors++;
+                }
+
+                r.moves += moves;
+            }
+        });
+    }
+
+    for (thread& t : workers) {
+        t.join();
+    }
+
+    PgnStats total;
+
+    for (PgnStats& r : results) {
+        total.games += r.games;
+        total.errors += r.errors;
+        total.moves += r.moves;
+    }
+
+    total.bytes = text.size();
+    total.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return total;
+}
+
+bool pgn_report(const char* path, int threads, ostream& os) {
+
+    MappedFile file(path);
+
+    if (!file.is_open()) {
+        os << "can't read " << path << endl;
+        return false;
+    }
+
+    PgnStats r = replay_pgn(file.view(), threads);
+    double seconds = max(r.seconds, 1e-9);
+
+    os << "games " << r.games << "\terrors " << r.errors << "\tmoves " << r.moves
+       << "\ttime " << int(r.seconds * 1000) << " ms\tgames/s " << uint64_t(r.games / seconds)
+       << "\tmoves/s " << uint64_t(r.moves / seconds) << "\tMB/s " << r.bytes / seconds / 1e6 << endl;
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include "board.hpp"
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*  PGN files: games of tag pairs ([White "name"]) followed by the moves in standard algebraic notation (SAN),
+    with move numbers, comments ({...} and ; to the end of the line), variations in parentheses,
+    numeric annotations ($1) and a result.
+
+    the reader walks a memory mapped file (or any text) game by game without copying it, the tags and
+    moves of a game are views into the text. replaying resolves every SAN move against the legal moves
+    of the board and makes it. large files are split into one part per thread at game boundaries.
+    see https://www.chessprogramming.org/Portable_Game_Notation
+*/
+
+// find the legal move of a SAN move (e4, Nbd7, exd8=Q+, O-O-O), returns false if there isn't exactly one
+bool parse_san(Board& b, string_view san, Move& move);
+
+// SAN of a legal move, with + or # if it gives check or mate
+string move2san(Board& b, Move m);
+
+struct PgnGame {
+    vector<pair<string_view, string_view>> tags;    // (name, value), the value without quotes
+    string_view movetext;
+
+    string_view tag(string_view name) const;        // empty if there is no such tag
+};
+
+class PgnReader {
+    private:
+        string_view text;
+        size_t pos = 0;
+    public:
+        explicit PgnReader(string_view text) : text(text) {}
+
+        // the next game, returns false at the end of the text
+        bool next(PgnGame& game);
+};
+
+// play the moves of the game on b, from the FEN tag or the starting position
+// on_move is called with every move before it is made, returns false on a move that can't be resolved
+bool replay_game(const PgnGame& game, Board& b, const function<void(Board&, Move)>& on_move = nullptr);
+
+struct PgnStats {
+    uint64_t games = 0;             // games replayed without error
+    uint64_t errors = 0;            // games with a bad move or FEN tag
+    uint64_t moves = 0;
+    uint64_t bytes = 0;
+    double seconds = 0;
+};
+
+// split text into parts of about the same size that start at a game
+vector<string_view> split_games(string_view text, int parts);
+
+// replay all games of the text, one part per thread
+PgnStats replay_pgn(string_view text, int threads);
+
+// replay all games of a PGN file and print games per second, returns false if the file can't be read
+bool pgn_report(const char* path, int threads, ostream& os);
+
+#endif //PGN_H
@@ -0,0 +1,146 @@
+#ifndef PSQT_H
+#define PSQT_H
+
+/*  piece-square tables: the value of a piece (material + a bonus for its square) for the middlegame and the endgame.
+    Board keeps the sum over all pieces and the game phase up to date while moves are made, and the evaluation
+    blends the two sums by the phase (tapered evaluation), so it doesn't have to look at the pieces.
+    see https://www.chessprogramming.org/Tapered_Eval
+
+    the square bonuses are the tables of the simplified evaluation function, with a king that moves to the center
+    and pawns that are worth more the further they are advanced in the endgame.
+    see https://www.chessprogramming.org/Simplified_Evaluation_Function
+
+    the tables are written from white's point of view with a8 first (like board64), and are built at compile time
+    into one table per piece, with black pieces mirrored and negated so the sums are always from white's point of view.
+*/
+
+struct Score {
+    int mg = 0;     // middlegame
+    int eg = 0;     // endgame
+
+    constexpr Score& operator+=(Score other) { mg += other.mg; eg += other.eg; return *this; }
+    constexpr Score& operator-=(Score other) { mg -= other.mg; eg -= other.eg; return *this; }
+    constexpr bool operator==(Score other) const { return mg == other.mg && eg == other.eg; }
+};
+
+const int MAX_PHASE = 24;                               // phase with all pieces on the board, 0 -> only kings and pawns
+const int phase_value[7] = {0, 0, 1, 1, 2, 4, 0};       // indexed by piece type
+
+const int material_mg[7] = {0, 82, 337, 365, 477, 1025, 0};
+const int material_eg[7] = {0, 94, 281, 297, 512, 936, 0};
+
+const int pawn_mg[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     10,  10,  20,  30,  30,  20,  10,  10,
+      5,   5,  10,  25,  25,  10,   5,   5,
+      0,   0,   0,  20,  20,   0,   0,   0,
+      5,  -5, -10,   0,   0, -10,  -5,   5,
+      5,  10,  10, -20, -20,  10,  10,   5,
+      0,   0,   0,   0,   0,   0,   0,   0
+};
+
+const int pawn_eg[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+     80,  80,  80,  80,  80,  80,  80,  80,
+     50,  50,  50,  50,  50,  50,  50,  50,
+     30,  30,  30,  30,  30,  30,  30,  30,
+     15,  15,  15,  15,  15,  15,  15,  15,
+      5,   5,   5,   5,   5,   5,   5,   5,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0
+};
+
+const int knight_psqt[64] = {
+    -50, -40, -30, -30, -30, -30, -40, -50,
+    -40, -20,   0,   0,   0,   0, -20, -40,
+    -30,   0,  10,  15,  15,  10,   0, -30,
+    -30,   5,  15,  20,  20,  15,   5, -30,
+    -30,   0,  15,  20,  20,  15,   0, -30,
+    -30,   5,  10,  15,  15,  10,   5, -30,
+    -40, -20,   0,   5,   5,   0, -20, -40,
+    -50, -40, -30, -30, -30, -30, -40, -50
+};
+
+const int bishop_psqt[64] = {
+    -20, -10, -10, -10, -10, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,  10,  10,   5,   0, -10,
+    -10,   5,   5,  10,  10,   5,   5, -10,
+    -10,   0,  10,  10,  10,  10,   0, -10,
+    -10,  10,  10,  10,  10,  10,  10, -10,
+    -10,   5,   0,   0,   0,   0,   5, -10,
+    -20, -10, -10, -10, -10, -10, -10, -20
+};
+
+const int rook_psqt[64] = {
+      0,   0,   0,   0,   0,   0,   0,   0,
+      5,  10,  10,  10,  10,  10,  10,   5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+     -5,   0,   0,   0,   0,   0,   0,  -5,
+      0,   0,   0,   5,   5,   0,   0,   0
+};
+
+const int queen_psqt[64] = {
+    -20, -10, -10,  -5,  -5, -10, -10, -20,
+    -10,   0,   0,   0,   0,   0,   0, -10,
+    -10,   0,   5,   5,   5,   5,   0, -10,
+     -5,   0,   5,   5,   5,   5,   0,  -5,
+      0,   0,   5,   5,   5,   5,   0,  -5,
+    -10,   5,   5,   5,   5,   5,   0, -10,
+    -10,   0,   5,   0,   0,   0,   0, -10,
+    -20, -10, -10,  -5,  -5, -10, -10, -20
+};
+
+const int king_mg[64] = {
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -30, -40, -40, -50, -50, -40, -40, -30,
+    -20, -30, -30, -40, -40, -30, -30, -20,
+    -10, -20, -20, -20, -20, -20, -20, -10,
+     20,  20,   0,   0,   0,   0,  20,  20,
+     20,  30,  10,   0,   0,  10,  30,  20
+};
+
+const int king_eg[64] = {
+    -50, -40, -30, -20, -20, -30, -40, -50,
+    -30, -20, -10,   0,   0, -10, -20, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  30,  40,  40,  30, -10, -30,
+    -30, -10,  20,  30,  30,  20, -10, -30,
+    -30, -30,   0,   0,   0,   0, -30, -30,
+    -50, -30, -30, -30, -30, -30, -30, -50
+};
+
+struct PieceSquareTable {
+    Score scores[15][64];       // [Piece::val][square index of board64]
+};
+
+constexpr PieceSquareTable make_psqt() {
+
+    const int* mg[7] = {nullptr, pawn_mg, knight_psqt, bishop_psqt, rook_psqt, queen_psqt, king_mg};
+    const int* eg[7] = {nullptr, pawn_eg, knight_psqt, bishop_psqt, rook_psqt, queen_psqt, king_eg};
+
+    PieceSquareTable table{};
+
+    for (int type = 1; type <= 6; type++) {
+        for (int sq = 0; sq < 64; sq++) {
+
+            Score s{material_mg[type] + mg[type][sq], material_eg[type] + eg[type][sq]};
+
+            table.scores[type][sq] = s;                                 // white
+            table.scores[type | 8][sq ^ 56] = Score{-s.mg, -s.eg};      // black, mirrored vertically
+        }
+    }
+
+    return table;
+}
+
+inline constexpr PieceSquareTable psqt = make_psqt();
+
+#endif //PSQT_H
@@ -0,0 +1,5 @@
+#!/bin/bash
+
+# micro benchmarks of the board, e.g. ./runbench.sh new.txt old.txt compares against the results of an earlier run
+g++ -O2 -pthread $CXXFLAGS bench.cpp board.cpp bitboard.cpp perft.cpp tt.cpp stats.cpp
+./a.out "$@"
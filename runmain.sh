@@ -1,4 +1,5 @@
 #!/bin/bash
 
-g++ main.cpp board.cpp
-./a.out
+# extra flags from the environment, e.g. CXXFLAGS="-DBITBOARDS" ./runmain.sh perftsuite
+g++ -O2 -pthread $CXXFLAGS main.cpp board.cpp bitboard.cpp perft.cpp tt.cpp eval.cpp search.cpp uci.cpp epd.cpp mapped_file.cpp book.cpp bitbase.cpp movepick.cpp stats.cpp match.cpp pgn.cpp training.cpp
+./a.out "$@"
\ No newline at end of file
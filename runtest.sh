@@ -1,4 +1,4 @@
 #!/bin/bash
 
-g++ test.cpp board.cpp
-./a.out
+g++ -O2 -pthread $CXXFLAGS test.cpp board.cpp bitboard.cpp perft.cpp tt.cpp eval.cpp search.cpp uci.cpp epd.cpp mapped_file.cpp book.cpp bitbase.cpp movepick.cpp stats.cpp match.cpp pgn.cpp training.cpp
+./a.out
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "search.hpp"
+#include "eval.hpp"
+#include "bitbase.hpp"
+#include "movepick.hpp"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+// mate scores are stored relative to the position in the transposition table, and relative to the root in the search
+static int score_to_tt(int score, int ply) {
+    return score >= MATE - MAX_PLY ? score + ply : score <= -MATE + MAX_PLY ? score - ply : score;
+}
+
+static int score_from_tt(int score, int ply) {
+    return score >= MATE - MAX_PLY ? score - ply : score <= -MATE + MAX_PLY ? score + ply : score;
+}
+
+// helper thread i skips the depths where (depth + skip_phase[i]) / skip_size[i] is odd
+static const int skip_size[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int skip_phase[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+static bool skip_depth(int thread_id, int depth) {
+
+    if (thread_id == 0) {
+        return false;
+    }
+
+    int i = (thread_id - 1) % 20;
+    return ((depth + skip_phase[i]) / skip_size[i]) % 2;
+}
+
+
+int Search::elapsed() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start_time).count();
+}
+
+// time since the start, or since the ponderhit of a search started in ponder mode
+int Search::limit_elapsed() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - limit_start).count();
+}
+
+// the time of a ponder search starts to count at the ponderhit
+bool Search::waiting_for_ponderhit() {
+
+    if (ponder_phase && !pondering) {
+        ponder_phase = false;
+        limit_start = chrono::steady_clock::now();
+    }
+
+    return ponder_phase;
+}
+
+void Search::check_limits() {
+
+    shared_nodes.store(nodes, memory_order_relaxed);
+
+    if (thread_id != 0) {
+        return;
+    }
+
+    if ((limits.nodes && nodes >= limits.nodes)
+        || (!waiting_for_ponderhit() && limits.movetime && limit_elapsed() >= limits.movetime)) {
+        stopped = true;
+    }
+}
+
+// search until the depth limit, node limit or time limit is reached or stop() is called
+// returns the last completed iteration (pv is empty if there are no legal moves)
+SearchInfo Search::run(SearchLimits search_limits) {
+
+    limits = search_limits;
+    start_time = limit_start = chrono::steady_clock::now();
+    ponder_phase = pondering;
+    nodes = 0;
+
+    fill(&killers[0][0], &killers[0][0] + MAX_PLY * 2, Move(0, 0, EMPTY));
+    fill(&history[0][0], &history[0][0] + 15 * 64, 0);
+
+    // the stop flag and table generation of a parallel search are reset once by SmpSearch
+    if (&stopped == &own_stop) {
+        stopped = false;
+        tt.new_search();
+    }
+
+    SearchInfo result;
+
+    for (int depth = 1; depth <= limits.depth; depth++) {
+
+        if (skip_depth(thread_id, depth)) {
+            continue;
+        }
+
+        int score = pvs(-INF, INF, depth, 0);
+
+        // an interrupted iteration is only used if there is no earlier one
+        if (stopped && !result.pv.empty()) {
+            break;
+        }
+
+        shared_nodes.store(nodes, memory_order_relaxed);
+
+        result.depth = depth;
+        result.score = score;
+        result.completed = !stopped;
+        result.pv.assign(pv_table[0], pv_table[0] + pv_length[0]);
+
+        result.nodes = nodes;
+        result.time = elapsed();
+        result.nps = result.time ? nodes * 1000 / result.time : 0;
+
+        if (on_iteration) {
+            on_iteration(result);
+        }
+
+        // stop when out of time, there are no legal moves, or a mate was found within the searched depth
+        if (stopped || result.pv.empty() || abs(score) >= MATE - depth) {
+            break;
+        }
+
+        // the next iteration would most likely not finish before the hard limit
+        if (thread_id == 0 && limits.soft_time && !waiting_for_ponderhit() && limit_elapsed() >= limits.soft_time) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+int Search::pvs(int alpha, int beta, int depth, int ply) {
+
+    pv_length[ply] = ply;
+
+    if (depth <= 0) {
+        return quiescence(alpha, beta, ply);
+    }
+
+    nodes++;
+
+    if ((nodes & 1023) == 0) {
+        check_limits();
+    }
+
+    if (stopped) {
+        return 0;
+    }
+
+    bool root = ply == 0;
+    bool pv_node = beta - alpha > 1;
+
+    // draw by repetition or fifty move rule
+    if (!root && (board.is_repetition() || board.get_halfmove() >= 100)) {
+        return 0;
+    }
+
+    if (ply >= MAX_PLY - 1) {
+        return evaluate(board);
+    }
+
+    // transposition table cutoff (not in pv nodes, so the pv stays complete)
+    uint64_t key = board.get_key();
+    TTData entry;
+    bool hit = tt.probe(key, entry);
+    uint16_t hash_move = hit ? entry.move : 0;
+
+    if (hit && !pv_node && entry.depth >= depth) {
+
+        int tt_score = score_from_tt(entry.score, ply);
+
+        if (entry.bound == BOUND_EXACT
+            || (entry.bound == BOUND_LOWER && tt_score >= beta)
+            || (entry.bound == BOUND_UPPER && tt_score <= alpha)) {
+            return tt_score;
+        }
+    }
+
+    bool in_check = board.in_check();
+
+    // solved endgames, positions in check are searched so mates are still found
+    if (!root && !in_check) {
+
+        Wdl wdl = probe_bitbase(board);
+
+        if (wdl == WDL_DRAW) {
+            return 0;
+        } else if (wdl == WDL_WIN) {
+            return KNOWN_WIN + evaluate(board);
+        } else if (wdl == WDL_LOSS) {
+            return -KNOWN_WIN + evaluate(board);
+        }
+    }
+
+    // check extension
+    if (in_check) {
+        depth++;
+    }
+
+    MovePicker picker(board, hash_move, killers[ply], history);
+
+    int best_score = -INF;
+    Move best_move(0, 0, EMPTY);
+    Bound bound = BOUND_UPPER;
+    int legal = 0;
+    Move m;
+
+    while (picker.next(m)) {
+
+        board.make_move(m, false);
+
+        tt.prefetch(board.get_key());
+        legal++;
+
+        int score;
+
+        if (legal == 1) {
+            score = -pvs(-beta, -alpha, depth - 1, ply + 1);
+        } else {
+            score = -pvs(-alpha - 1, -alpha, depth - 1, ply + 1);
+
+            if (score > alpha && score < beta) {
+                score = -pvs(-beta, -alpha, depth - 1, ply + 1);
+            }
+        }
+
+        board.unmake_move(m);
+
+        if (stopped) {
+            return 0;
+        }
+
+        if (score > best_score) {
+            best_score = score;
+            best_move = m;
+
+            if (score > alpha) {
+                alpha = score;
+                bound = BOUND_EXACT;
+
+                // pv of this node = this move + pv of the child
+                pv_table[ply][ply] = m;
+                for (int j = ply + 1; j < pv_length[ply + 1]; j++) {
+                    pv_table[ply][j] = pv_table[ply + 1][j];
+                }
+                pv_length[ply] = pv_length[ply + 1];
+
+                if (alpha >= beta) {
+                    bound = BOUND_LOWER;
+
+                    if (!is_tactical(m)) {
+                        update_quiet_stats(m, depth, ply);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    // checkmate or stalemate
+    if (!legal) {
+        return in_check ? -MATE + ply : 0;
+    }
+
+    tt.store(key, pack_move(best_move), score_to_tt(best_score, ply), depth, bound);
+
+    return best_score;
+}
+
+// a quiet move caused a cutoff: it becomes the first killer of the ply and its history entry grows
+// with the square of the depth (cutoffs far from the leaves are worth more), the table is halved when it gets too large
+void Search::update_quiet_stats(Move m, int depth, int ply) {
+
+    if (!same_move(m, killers[ply][0])) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = m;
+    }
+
+    int& entry = history[board.get(m.start).val][board120[m.end]];
+    entry += depth * depth;
+
+    if (entry > HISTORY_MAX) {
+        for (auto& row : history) {
+            for (int& h : row) {
+                h /= 2;
+            }
+        }
+    }
+}
+
+// search captures only until the position is quiet, the side to play can always stand pat
+int Search::quiescence(int alpha, int beta, int ply) {
+
+    nodes++;
+
+    if ((nodes & 1023) == 0) {
+        check_limits();
+    }
+
+    if (stopped) {
+        return 0;
+    }
+
+    int stand_pat = evaluate(board);
+
+    if (ply >= MAX_PLY - 1 || stand_pat >= beta) {
+        return stand_pat;
+    }
+
+    alpha = max(alpha, stand_pat);
+
+    MovePicker picker(board);
+    Move m;
+
+    while (picker.next(m)) {
+
+        // captures that lose material can't raise alpha above the stand pat score
+        if (!board.see_ge(m, 0)) {
+            continue;
+        }
+
+        board.make_move(m, false);
+
+        int score = -quiescence(-beta, -alpha, ply + 1);
+        board.unmake_move(m);
+
+        if (stopped) {
+            return 0;
+        }
+
+        if (score > alpha) {
+            alpha = score;
+
+            if (alpha >= beta) {
+                break;
+            }
+        }
+    }
+
+    return alpha;
+}
+
+
+// run the search on all threads, returns the result of the thread that completed the deepest iteration
+// (the main thread's result if no thread completed one)
+SearchInfo SmpSearch::run(const Board& b, SearchLimits limits) {
+
+    stopped = false;
+    tt.new_search();
+
+    searches.clear();
+    for (int i = 0; i < threads; i++) {
+        searches.emplace_back(new Search(b, tt, i, &stopped, &pondering));
+    }
+
+    // iterations of the main thread are reported with the nodes of all threads
+    searches[0]->on_iteration = [this](const SearchInfo& info) {
+
+        if (on_iteration) {
+
+            SearchInfo total = info;
+            total.nodes = 0;
+
+            for (auto& search : searches) {
+                total.nodes += search->get_nodes();
+            }
+
+            total.nps = total.time ? total.nodes * 1000 / total.time : 0;
+            on_iteration(total);
+        }
+    };
+
+    vector<SearchInfo> results(threads);
+    vector<thread> helpers;
+
+    SearchLimits helper_limits;
+    helper_limits.depth = limits.depth;
+
+    for (int i = 1; i < threads; i++) {
+        helpers.emplace_back([&, i]() { results[i] = searches[i]->run(helper_limits); });
+    }
+
+    results[0] = searches[0]->run(limits);
+
+    stopped = true;
+    for (thread& t : helpers) {
+        t.join();
+    }
+
+    SearchInfo best = results[0];
+
+    for (int i = 1; i < threads; i++) {
+        if (results[i].completed && !results[i].pv.empty() && (results[i].depth > best.depth || !best.completed)) {
+            best = results[i];
+        }
+    }
+
+    best.nodes = 0;
+    for (auto& search : searches) {
+        best.nodes += search->get_nodes();
+    }
+
+    best.time = searches[0]->elapsed();
+    best.nps = best.time ? best.nodes * 1000 / best.time : 0;
+
+    return best;
+}
+
+void smp_benchmark(const Board& b, int depth, int max_threads, size_t hash_mb, ostream& os) {
+
+    TranspositionTable tt(hash_mb);
+    SearchLimits limits;
+    limits.depth = depth;
+
+    int base_time = 0;
+    uint64_t base_nps = 0;
+
+    for (int threads = 1; threads <= max_threads; threads = threads * 2 > max_threads && threads < max_threads ? max_threads : threads * 2) {
+
+        tt.clear();
+        SmpSearch search(tt, threads);
+        SearchInfo result = search.run(b, limits);
+
+        if (threads == 1) {
+            base_time = max(result.time, 1);
+            base_nps = max(result.nps, uint64_t(1));
+        }
+
+        os << "threads " << threads << "\tdepth " << result.depth << "\ttime " << result.time << " ms"
+           << "\tnodes " << result.nodes << "\tnps " << result.nps
+           << "\ttime speedup " << double(base_time) / max(result.time, 1)
+           << "\tnps speedup " << double(result.nps) / base_nps
+           << "\tbestmove " << (result.pv.empty() ? "(none)" : move2str(result.pv[0])) << endl;
+    }
+}
+
+void print_info(const SearchInfo& info, ostream& os) {
+
+    os << "info depth " << info.depth << " score ";
+
+    if (abs(info.score) >= MATE - MAX_PLY) {
+        int plies = MATE - abs(info.score);
+        os << "mate " << (info.score > 0 ? (plies + 1) / 2 : -plies / 2);
+    } else {
+        os << "cp " << info.score;
+    }
+
+    os << " nodes " << info.nodes << " nps " << info.nps << " time " << info.time << " pv";
+
+    for (Move m : info.pv) {
+        os << " " << move2str(m);
+    }
+
+    os << endl;
+}
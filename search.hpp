@@ -0,0 +1,113 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "board.hpp"
+#include "tt.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/*  iterative deepening principal variation search (alpha-beta with null windows for all but the first move)
+    with a quiescence search over captures at the leaves. moves come from a staged MovePicker (movepick.hpp).
+    see https://www.chessprogramming.org/Principal_Variation_Search
+*/
+
+const int INF = 32000;
+const int MATE = 31000;             // score of mate in 0, mate in n plies is MATE - n
+const int MAX_PLY = 128;
+const int KNOWN_WIN = 20000;        // score of a won bitbase position, plus the evaluation so the search makes progress
+
+struct SearchLimits {
+    int depth = MAX_PLY - 1;
+    uint64_t nodes = 0;             // 0 -> no limit
+    int movetime = 0;               // ms, hard limit: the search is stopped when it is reached, 0 -> no limit
+    int soft_time = 0;              // ms, soft limit: no new iteration is started after it, 0 -> no limit
+};
+
+// result of a completed iteration
+struct SearchInfo {
+    int depth = 0;
+    int score = 0;
+    uint64_t nodes = 0;
+    int time = 0;                   // ms
+    uint64_t nps = 0;
+    vector<Move> pv;
+    bool completed = false;         // false -> the iteration was interrupted (only used when there is no earlier one)
+};
+
+class Search {
+    private:
+        Board board;                // own copy, the board of the caller is never touched
+        TranspositionTable& tt;
+        SearchLimits limits;
+        chrono::steady_clock::time_point start_time;
+        std::atomic<bool> own_stop{false};
+        std::atomic<bool>& stopped;         // own_stop, or the flag shared by all threads of a parallel search
+        std::atomic<bool> own_ponder{false};
+        std::atomic<bool>& pondering;       // while set, the time limits are not checked (own_ponder or shared)
+        bool ponder_phase = false;          // search started in ponder mode and no ponderhit seen yet
+        chrono::steady_clock::time_point limit_start;  // time limits count from here (start or ponderhit)
+        int thread_id;                      // 0 -> main thread, checks the limits
+        uint64_t nodes = 0;
+        std::atomic<uint64_t> shared_nodes{0};  // copy of nodes that other threads can read, updated every 1024 nodes
+
+        Move pv_table[MAX_PLY][MAX_PLY];    // triangular pv table, pv_table[ply] is the pv from ply on
+        int pv_length[MAX_PLY];
+
+        Move killers[MAX_PLY][2];           // last two quiet moves that caused a cutoff at each ply
+        int history[15][64];                // cutoffs of quiet moves by [Piece::val][target square (board64 index)]
+
+        int pvs(int alpha, int beta, int depth, int ply);
+        int quiescence(int alpha, int beta, int ply);
+        void update_quiet_stats(Move m, int depth, int ply);
+        void check_limits();
+        bool waiting_for_ponderhit();
+        int limit_elapsed();
+    public:
+        Search(const Board& b, TranspositionTable& tt, int thread_id = 0,
+               std::atomic<bool>* shared_stop = nullptr, std::atomic<bool>* shared_ponder = nullptr)
+            : board(b), tt(tt), stopped(shared_stop ? *shared_stop : own_stop),
+              pondering(shared_ponder ? *shared_ponder : own_ponder), thread_id(thread_id) {}
+
+        std::function<void(const SearchInfo&)> on_iteration;     // called after every completed iteration
+
+        SearchInfo run(SearchLimits search_limits);
+        void stop() { stopped = true; }
+        void set_pondering(bool on) { pondering = on; }     // set before run, cleared by ponderhit
+        int elapsed();
+        uint64_t get_nodes() { return shared_nodes.load(std::memory_order_relaxed); }
+};
+
+/*  lazy smp: all threads search the same position with their own board copy and share the transposition table.
+    helper threads skip some depths of the iterative deepening (different per thread), so they are ahead of the
+    main thread and fill the table with results it can use. the main thread checks the limits and stops the helpers.
+    see https://www.chessprogramming.org/Lazy_SMP
+*/
+class SmpSearch {
+    private:
+        TranspositionTable& tt;
+        int threads;
+        std::atomic<bool> stopped{false};
+        std::atomic<bool> pondering{false};
+        vector<unique_ptr<Search>> searches;
+    public:
+        SmpSearch(TranspositionTable& tt, int threads = 1) : tt(tt), threads(max(threads, 1)) {}
+
+        std::function<void(const SearchInfo&)> on_iteration;     // iterations of the main thread, with nodes of all threads
+
+        SearchInfo run(const Board& b, SearchLimits limits);
+        void stop() { stopped = true; }
+        void set_pondering(bool on) { pondering = on; }
+        void set_threads(int n) { threads = max(n, 1); }
+        int get_threads() { return threads; }
+};
+
+// time to depth and nodes per second of the smp search with 1, 2, 4, ... max_threads threads
+void smp_benchmark(const Board& b, int depth, int max_threads, size_t hash_mb, ostream& os);
+
+// print info in uci format: info depth 5 score cp 20 nodes 1234 nps 5678 time 12 pv e2e4 e7e5
+void print_info(const SearchInfo& info, ostream& os);
+
+#endif //SEARCH_H
@@ -0,0 +1,112 @@
+#include "stats.hpp"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+static mutex registry_lock;
+static vector<unique_ptr<Stats>> registry;     // blocks of all threads that counted something
+
+Stats& Stats::operator+=(const Stats& other) {
+
+    for (int i = 0; i < STAT_COUNTER_NUM; i++) {
+        counters[i] += other.counters[i];
+    }
+
+    for (int i = 0; i < STAT_TIMER_NUM; i++) {
+        timer_calls[i] += other.timer_calls[i];
+        timer_cycles[i] += other.timer_cycles[i];
+    }
+
+    return *this;
+}
+
+#ifdef STATS
+
+thread_local Stats* local_stats = nullptr;
+
+Stats* register_thread_stats() {
+
+    lock_guard<mutex> lock(registry_lock);
+    registry.emplace_back(new Stats());
+
+    return registry.back().get();
+}
+
+#endif
+
+// the counters of running threads are read without synchronization, they can be a few increments behind
+Stats merged_stats() {
+
+    lock_guard<mutex> lock(registry_lock);
+    Stats total;
+
+    for (auto& s : registry) {
+        total += *s;
+    }
+
+    return total;
+}
+
+void reset_stats() {
+
+    lock_guard<mutex> lock(registry_lock);
+
+    for (auto& s : registry) {
+        *s = Stats();
+    }
+}
+
+void stats_json(ostream& os) {
+
+    Stats total = merged_stats();
+    size_t threads;
+
+    {
+        lock_guard<mutex> lock(registry_lock);
+        threads = registry.size();
+    }
+
+    os << "{\"threads\": " << threads << ", \"counters\": {";
+
+    for (int i = 0; i < STAT_COUNTER_NUM; i++) {
+        os << (i ? ", " : "") << "\"" << stat_counter_str[i] << "\": " << total.counters[i];
+    }
+
+    os << "}, \"timers\": {";
+
+    for (int i = 0; i < STAT_TIMER_NUM; i++) {
+        os << (i ? ", " : "") << "\"" << stat_timer_str[i] << "\": {\"calls\": " << total.timer_calls[i]
+           << ", \"cycles\": " << total.timer_cycles[i] << "}";
+    }
+
+    os << "}}" << endl;
+}
+
+void stats_report(ostream& os) {
+
+    if (!stats_enabled) {
+        return;
+    }
+
+    Stats total = merged_stats();
+
+    os << "stats" << endl;
+
+    for (int i = 0; i < STAT_COUNTER_NUM; i++) {
+        os << "  " << stat_counter_str[i] << "\t" << total.counters[i] << endl;
+    }
+
+    for (int i = 0; i < STAT_TIMER_NUM; i++) {
+        if (total.timer_calls[i]) {
+            os << "  " << stat_timer_str[i] << "\t" << total.timer_cycles[i] / total.timer_calls[i] << " cycles/call" << endl;
+        }
+    }
+
+    ofstream file("stats.json");
+    stats_json(file);
+
+    os << "stats written to stats.json" << endl;
+}
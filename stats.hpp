@@ -0,0 +1,117 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <ostream>
+
+/*  instrumentation of the hot paths, switched on at compile time:
+        -DSTATS             counts calls of the board routines below
+        -DSTATS_TIMERS      also measures the cycles spent in them (rdtsc, includes the calls they make)
+    without the flags the STAT_ macros are empty and nothing is counted.
+
+    every thread counts into its own cache line aligned block, so threads don't share cache lines while counting.
+    the blocks stay registered after their thread ends and are summed when the stats are read.
+*/
+
+enum StatCounter {
+    STAT_POSSIBLE_MOVES,
+    STAT_GENERATE_MOVES,
+    STAT_GENERATED_MOVES,       // legal moves returned by generate_moves
+    STAT_ILLEGAL_MOVES,         // pseudo legal moves rejected: by the legality filter of generate_moves or by make_move
+    STAT_MAKE_MOVE,
+    STAT_UNMAKE_MOVE,
+    STAT_IS_ATTACKED,
+    STAT_MOVE_WAS_LEGAL,
+    STAT_COUNTER_NUM
+};
+
+const char* const stat_counter_str[] = {
+    "possible_moves", "generate_moves", "generated_moves", "illegal_moves",
+    "make_move", "unmake_move", "is_attacked", "move_was_legal"
+};
+
+enum StatTimer {
+    TIMER_GENERATE_MOVES,
+    TIMER_MAKE_MOVE,
+    TIMER_UNMAKE_MOVE,
+    TIMER_IS_ATTACKED,
+    STAT_TIMER_NUM
+};
+
+const char* const stat_timer_str[] = {"generate_moves", "make_move", "unmake_move", "is_attacked"};
+
+struct alignas(64) Stats {
+    uint64_t counters[STAT_COUNTER_NUM] = {0};
+    uint64_t timer_calls[STAT_TIMER_NUM] = {0};
+    uint64_t timer_cycles[STAT_TIMER_NUM] = {0};
+
+    Stats& operator+=(const Stats& other);
+};
+
+#if defined(STATS_TIMERS) && !defined(STATS)
+#define STATS
+#endif
+
+#ifdef STATS
+
+const bool stats_enabled = true;
+
+extern thread_local Stats* local_stats;
+Stats* register_thread_stats();
+
+// the block of the calling thread, registered on first use
+inline Stats& thread_stats() {
+    return local_stats ? *local_stats : *(local_stats = register_thread_stats());
+}
+
+#define STAT_INC(c) (thread_stats().counters[c]++)
+#define STAT_ADD(c, n) (thread_stats().counters[c] += (n))
+
+#else
+
+const bool stats_enabled = false;
+
+#define STAT_INC(c) ((void)0)
+#define STAT_ADD(c, n) ((void)0)
+
+#endif
+
+#ifdef STATS_TIMERS
+
+#include <x86intrin.h>
+
+// adds the cycles from construction to destruction to a timer
+class StatScope {
+    private:
+        StatTimer timer;
+        uint64_t start;
+    public:
+        explicit StatScope(StatTimer timer) : timer(timer), start(__rdtsc()) {}
+        ~StatScope() {
+            Stats& s = thread_stats();
+            s.timer_calls[timer]++;
+            s.timer_cycles[timer] += __rdtsc() - start;
+        }
+};
+
+#define STAT_TIMER(t) StatScope stat_scope(t)
+
+#else
+
+#define STAT_TIMER(t) ((void)0)
+
+#endif
+
+// sum of all threads
+Stats merged_stats();
+
+// set the counters of all threads to 0 (no thread may be counting at the same time)
+void reset_stats();
+
+// {"threads": 2, "counters": {"make_move": 123, ...}, "timers": {"make_move": {"calls": 123, "cycles": 4567}, ...}}
+void stats_json(std::ostream& os);
+
+// summary of the counters and timers, and the json written to stats.json (nothing if stats are disabled)
+void stats_report(std::ostream& os);
+
+#endif //STATS_H
@@ -1,8 +1,24 @@
 #include "board.hpp"
+#include "perft.hpp"
+#include "tt.hpp"
+#include "search.hpp"
+#include "eval.hpp"
+#include "uci.hpp"
+#include "epd.hpp"
+#include "book.hpp"
+#include "bitbase.hpp"
+#include "movepick.hpp"
+#include "match.hpp"
+#include "pgn.hpp"
+#include "training.hpp"
+#include "mapped_file.hpp"
+#include <cstdio>
 #include <stdlib.h>
 #include <assert.h>
 #include <string>
 #include <iostream>
+#include <sstream>
+#include <functional>
 #include <algorithm>
 #include <bitset>
 
@@ -87,15 +103,971 @@ bool kingmoves() {
     return true;
 }
 
+// test if perft node counts of the reference positions are correct up to depth 3
+bool perftcounts() {
+
+    for (int i = 0; i < perft_positions_num; i++) {
+
+        for (int depth = 1; depth <= 3; depth++) {
+            Board b(perft_positions[i].fen);
+
+            if (perft(b, depth) != perft_positions[i].nodes[depth - 1]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// positions with en passant, castling, promotion and check edge cases, with node count at given depth
+struct EdgeCase {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+const EdgeCase edgecases[] = {
+    {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},              // en passant would expose the king
+    {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+    {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},            // en passant capture gives check
+    {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},                  // castling gives check
+    {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+    {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},      // castling rights
+    {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},       // castling through attacked squares
+    {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},              // promotion out of check
+    {"8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658},            // discovered check
+    {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},                  // promotion gives check
+    {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},                    // underpromotion gives check
+    {"K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217},                     // stalemate
+    {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},                  // stalemate and checkmate
+    {"8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527}                 // double check
+};
+
+bool perftedgecases() {
+
+    for (const EdgeCase& e : edgecases) {
+        Board b(e.fen);
+
+        if (perft(b, e.depth) != e.nodes) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// test if parallel perft with and without hash table gives the same counts
+bool perftparallel() {
+
+    vector<PerftThreadStats> stats;
+
+    for (int i = 0; i < perft_positions_num; i++) {
+        Board b(perft_positions[i].fen);
+
+        if (perft_parallel(b, 3, 3, 0, stats) != perft_positions[i].nodes[2]
+            || perft_parallel(b, 4, 2, 1, stats) != perft_positions[i].nodes[3]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// check of a position on a walk of the move tree
+using Check = function<bool(Board&)>;
+
+// run the check on every position of the move tree up to depth, the key must be the same again after the moves are unmade
+bool walk(Board& b, int depth, const Check& check) {
+
+    if (!check(b)) {
+        return false;
+    }
+
+    if (depth == 0) {
+        return true;
+    }
+
+    uint64_t key = b.get_key();
+    MoveList moves;
+    b.generate_moves(moves);
+
+    for (Move m : moves) {
+
+        bool correct = !b.make_move(m) || walk(b, depth - 1, check);
+        b.unmake_move(m);
+
+        if (!correct || b.get_key() != key) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// walk from every reference position
+bool walk_positions(int depth, const Check& check) {
+
+    for (int i = 0; i < perft_positions_num; i++) {
+        Board b(perft_positions[i].fen);
+
+        if (!walk(b, depth, check)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// walk from every edge case
+bool walk_edgecases(int depth, const Check& check) {
+
+    for (const EdgeCase& e : edgecases) {
+        Board b(e.fen);
+
+        if (!walk(b, depth, check)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// the incrementally updated zobrist key matches the key computed from scratch
+bool zobrist_check(Board& b) {
+    return b.get_key() == b.compute_key();
+}
+
+bool zobristkeys() {
+    return walk_positions(3, zobrist_check);
+}
+
+// the incrementally updated piece-square sum matches the sum computed from scratch
+bool psqt_check(Board& b) {
+    return b.get_psqt() == b.compute_psqt();
+}
+
+// incremental evaluation matches a full scan, and mirrored positions evaluate the same for the side to play
+bool incrementaleval() {
+
+    if (!walk_positions(3, psqt_check)) {
+        return false;
+    }
+
+    Board start;
+    Board white("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Board black("r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R b KQkq - 0 1");
+
+    return evaluate(start) == 0 && evaluate(white) == evaluate(black) && start.get_phase() == MAX_PHASE;
+}
+
+// the picker hands out every legal move exactly once, whatever the hash move and killers are
+bool picker_moves(Board& b, uint16_t hash_move, const Move killers[2]) {
+
+    static const int history[15][64] = {};
+
+    MoveList all;
+    b.generate_moves(all);
+
+    MovePicker picker(b, hash_move, killers, history);
+    vector<Move> picked;
+    Move m;
+
+    while (picker.next(m)) {
+        picked.push_back(m);
+    }
+
+    if ((int)picked.size() != all.size) {
+        return false;
+    }
+
+    for (Move a : all) {
+        if (count_if(picked.begin(), picked.end(), [a](Move p) { return same_move(p, a) && p.captured == a.captured; }) != 1) {
+            return false;
+        }
+    }
+
+    // a legal quiet killer comes before the other quiet moves
+    for (int k = 0; k < 2; k++) {
+
+        auto killer = find_if(picked.begin(), picked.end(), [&](Move p) { return same_move(p, killers[k]); });
+
+        if (killer != picked.end() && !is_tactical(*killer)
+            && any_of(picked.begin(), killer, [&](Move p) {
+                   return !is_tactical(p) && pack_move(p) != hash_move && !same_move(p, killers[0]) && !same_move(p, killers[1]);
+               })) {
+            return false;
+        }
+    }
+
+    // captures only: all captures and queen promotions
+    int tactical = count_if(all.begin(), all.end(), [](Move a) { return is_tactical(a) && (a.flag < KNIGHT_PROMO || a.flag == QUEEN_PROMO); });
+    MovePicker captures(b);
+    int n = 0;
+
+    while (captures.next(m)) {
+        if (!is_tactical(m)) {
+            return false;
+        }
+        n++;
+    }
+
+    return n == tactical;
+}
+
+// hash moves and killers from the position itself and from the parent position (often not legal here)
+bool picker_walk(Board& b, int depth, Move parent_move) {
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    Move none(0, 0, EMPTY);
+    Move own_killers[2] = {moves.size ? moves[moves.size - 1] : none, parent_move};
+    Move parent_killers[2] = {parent_move, none};
+
+    if (!picker_moves(b, moves.size ? pack_move(moves[moves.size / 2]) : 0, own_killers)
+        || !picker_moves(b, parent_move.start != parent_move.end ? pack_move(parent_move) : 0, parent_killers)) {
+        return false;
+    }
+
+    if (depth == 0) {
+        return true;
+    }
+
+    for (int i = 0; i < moves.size; i++) {
+
+        Move m = moves[i];
+
+        b.make_move(m, false);
+        bool correct = picker_walk(b, depth - 1, moves[(i + 1) % moves.size]);
+        b.unmake_move(m);
+
+        if (!correct) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool movepicker() {
+
+    for (int i = 0; i < perft_positions_num; i++) {
+        Board b(perft_positions[i].fen);
+
+        if (!picker_walk(b, 2, Move(0, 0, EMPTY))) {
+            return false;
+        }
+    }
+
+    for (const EdgeCase& e : edgecases) {
+        Board b(e.fen);
+
+        if (!picker_walk(b, 2, Move(0, 0, EMPTY))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// exchanges with known results (x-rays, en passant, promotion, king captures), and see_ge matches see
+// for every tactical move of the perft positions
+struct Exchange {
+    const char* fen;
+    const char* move;
+    int result;
+};
+
+const Exchange exchanges[] = {
+    {"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100},              // undefended pawn
+    {"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -220},    // knight for a pawn
+    {"3rk3/8/8/3p4/8/8/3R4/3R2K1 w - - 0 1", "d2d5", 100},                         // rook behind rook
+    {"3rk3/3r4/8/3p4/8/8/3R4/3R2K1 w - - 0 1", "d2d5", -400},                      // two rooks on both sides
+    {"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100},                            // en passant
+    {"3r2k1/2P5/8/8/8/8/8/4K3 w - - 0 1", "c7d8q", 1300},                          // capture and promote
+    {"1r4k1/2P5/8/8/8/8/8/4K3 w - - 0 1", "c7c8q", -100},                          // promote and lose the queen
+    {"4k3/8/8/3p4/4K3/8/8/8 w - - 0 1", "e4d5", 100},                              // king takes an undefended pawn
+    {"4k3/8/4p3/3p4/8/2B5/8/4K3 w - - 0 1", "c3g7", 0}                             // quiet move, nothing to win
+};
+
+bool see_check(Board& b) {
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    for (Move m : moves) {
+
+        if (!is_tactical(m)) {
+            continue;
+        }
+
+        int see = b.see(m);
+
+        for (int threshold : {-900, -320, -100, -1, 0, 1, 100, 220, 320, 900}) {
+            if (b.see_ge(m, threshold) != (see >= threshold)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool staticexchange() {
+
+    for (const Exchange& e : exchanges) {
+        Board b(e.fen);
+        Move m;
+
+        if (!parse_move(b, e.move, m) || b.see(m) != e.result || !b.see_ge(m, e.result) || b.see_ge(m, e.result + 1)) {
+            return false;
+        }
+    }
+
+    return walk_positions(1, see_check);
+}
+
+// games end by mate, stalemate and the fifty move rule with the right result, and the sprt moves the right way
+bool matchgames() {
+
+    MatchSettings settings;
+    settings.limits[0].nodes = settings.limits[1].nodes = 2000;
+    TranspositionTable tts[2] = {TranspositionTable(1, false), TranspositionTable(1, false)};
+
+    GameRecord mate = play_game("7k/8/6K1/8/8/8/8/Q7 w - - 0 1", true, settings, tts);
+    GameRecord stalemate = play_game("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", false, settings, tts);
+    GameRecord fifty = play_game("4k3/8/8/8/8/8/8/4K2R w - - 100 80", true, settings, tts);
+
+    // more games than two per opening, the opening is played again (a mate in one, so A wins with white)
+    settings.max_games = 6;
+    ostringstream results, progress;
+    MatchResult repeated = run_match({"7k/8/6K1/8/8/8/8/Q7 w - - 0 1"}, settings, results, progress);
+
+    // EPD files with CRLF line ends
+    vector<string> openings = read_openings("# openings\r\n7k/8/6K1/8/8/8/8/Q7 w - - 0 1\r\n" FEN_START "\r\n");
+
+    return mate.end == END_MATE && mate.score == 2 && mate.plies == 1
+        && stalemate.end == END_STALEMATE && stalemate.score == 1 && stalemate.plies == 0
+        && fifty.end == END_FIFTY_MOVES && fifty.score == 1
+        && repeated.wins == 3 && repeated.losses == 3 && repeated.draws == 0
+        && openings.size() == 2 && openings[1] == FEN_START
+        && sprt_llr(60, 20, 20, 0, 5) > 0 && sprt_llr(20, 20, 60, 0, 5) < 0 && sprt_llr(0, 0, 0, 0, 5) == 0;
+}
+
+// every legal move converted to SAN and parsed back is the same move
+bool san_check(Board& b) {
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    for (Move m : moves) {
+
+        Move parsed;
+
+        if (!parse_san(b, move2san(b, m), parsed) || !same_move(m, parsed)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const char* pgn_text =
+    "[Event \"test\"]\n"
+    "[White \"a\"]\n"
+    "[Black \"b\"]\n"
+    "[Result \"1-0\"]\n"
+    "\n"
+    "1. e4 e5 2. Nf3 {a [comment]\n"
+    "[over lines]} Nc6 (2... d6 3. d4) 3. Bc4 $1 Bc5 4. O-O Nf6 ; to the end of the line 1-0\n"
+    "5.d3 d6 1-0\n"
+    "\n"
+    "[Event \"promotion\"]\n"
+    "[FEN \"4k3/1P6/8/8/8/8/8/4K3 w - - 0 1\"]\n"
+    "\n"
+    "1. b8=Q+ Kd7 2. Qb7+ Kd6 *\n"
+    "\n"
+    "[Event \"illegal\"]\n"
+    "\n"
+    "1. e4 e4 *\n";
+
+// SAN round trip in the reference positions, and the games of a PGN text with tags, comments, variations and promotions
+bool pgnreplay() {
+
+    if (!walk_positions(1, san_check) || !walk_edgecases(1, san_check)) {
+        return false;
+    }
+
+    PgnReader reader(pgn_text);
+    PgnGame game;
+    Board b;
+    vector<string> sans[3];
+    bool replayed[3];
+
+    for (int i = 0; i < 3; i++) {
+
+        if (!reader.next(game)) {
+            return false;
+        }
+
+        replayed[i] = replay_game(game, b, [&](Board& board, Move m) { sans[i].push_back(move2san(board, m)); });
+
+        if (i == 0 && (game.tag("Result") != "1-0" || game.tag("Round") != "")) {
+            return false;
+        }
+    }
+
+    vector<string> first = {"e4", "e5", "Nf3", "Nc6", "Bc4", "Bc5", "O-O", "Nf6", "d3", "d6"};
+    vector<string> second = {"b8=Q+", "Kd7", "Qb7+", "Kd6"};
+
+    if (reader.next(game) || !replayed[0] || !replayed[1] || replayed[2] || sans[0] != first || sans[1] != second) {
+        return false;
+    }
+
+    // the same result with the text split between threads
+    for (int threads : {1, 2, 3, 8}) {
+
+        PgnStats stats = replay_pgn(pgn_text, threads);
+
+        if (stats.games != 2 || stats.errors != 1 || stats.moves != 15) {
+            return false;
+        }
+    }
+
+    // a game without moves keeps its own tags (CRLF line ends)
+    PgnReader no_moves("[Event \"empty\"]\r\n\r\n[Event \"next\"]\r\n\r\n1. e4 *\r\n");
+    bool empty_game = no_moves.next(game) && game.tags.size() == 1 && replay_game(game, b, nullptr)
+                      && no_moves.next(game) && game.tag("Event") == "next" && !no_moves.next(game);
+
+    // knights moving back and forth past the 75 move rule, the board can't be set up again when the history is full
+    string shuffle;
+
+    for (int i = 0; i < MAX_HISTORY / 4; i++) {
+        shuffle += "Nf3 Nf6 Ng1 Ng8 ";
+    }
+
+    PgnReader long_game(shuffle);
+
+    return empty_game && long_game.next(game) && !replay_game(game, b, nullptr);
+}
+
+// every position packed and unpacked again has the same FEN and key
+bool packed_check(Board& b) {
+
+    PackedPosition packed;
+    Board unpacked;
+
+    return b.to_packed(packed) && unpacked.set_packed(packed) == FEN_OK
+        && unpacked.to_fen() == b.to_fen() && unpacked.get_key() == b.get_key();
+}
+
+// packed positions round trip, broken ones are rejected, and the records of the PGN games are written to a file
+bool packedpositions() {
+
+    if (!walk_positions(2, packed_check) || !walk_edgecases(2, packed_check)) {
+        return false;
+    }
+
+    Board b("r3k2r/8/8/8/3pP3/8/8/R3K2R b KQkq e3 0 40"), unpacked;
+    PackedPosition packed, broken;
+    b.to_packed(packed);
+
+    broken = packed;
+    broken.pieces[0] = (broken.pieces[0] & 0xf0) | 7;          // no such piece on a8
+    bool bad_piece = unpacked.set_packed(broken) == FEN_BAD_PLACEMENT;
+
+    Board kings("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    kings.to_packed(broken);
+    broken.castle_en_pass |= 1;                                 // white kingside right without a rook
+    bool bad_castling = unpacked.set_packed(broken) == FEN_BAD_CASTLING;
+
+    broken = packed;
+    broken.castle_en_pass = (broken.castle_en_pass & 15) | 4 << 4;   // no white pawn on d4
+    bool bad_en_passant = unpacked.set_packed(broken) == FEN_BAD_EN_PASSANT;
+
+    // more pieces than the piece lists hold: kings on h8 and h1 with 11 white knights on a6-c5, or 9 white pawns on a3-a2
+    PackedPosition knights = {{0x80, 0, 0xff, 0x07, 0, 0, 0, 0x80}, {0x2e, 0x22, 0x22, 0x22, 0x22, 0x22, 0x06}, 0, 0, {1, 0}};
+    PackedPosition pawns = {{0x80, 0, 0, 0, 0, 0xff, 0x01, 0x80}, {0x1e, 0x11, 0x11, 0x11, 0x11, 0x06}, 0, 0, {1, 0}};
+    bool too_many = unpacked.set_packed(knights) == FEN_BAD_PLACEMENT && unpacked.set_packed(pawns) == FEN_BAD_PLACEMENT;
+
+    // the halfmove clock goes past 127 without changing the side to play, clocks past MAX_HALFMOVE aren't packed
+    Board clock("8/8/8/4k3/8/8/8/r5K1 b - - 127 80");
+    Move quiet;
+    parse_move(clock, "a1a2", quiet);
+    clock.make_move(quiet);
+    bool clock_kept = clock.to_packed(broken) && unpacked.set_packed(broken) == FEN_OK
+                      && unpacked.to_fen() == "8/8/8/4k3/8/8/r7/6K1 w - - 128 81";
+
+    broken.halfmove = MAX_HALFMOVE + 1;
+    bool bad_clock = unpacked.set_packed(broken) == FEN_BAD_CLOCK;
+
+    clock.set_fen("8/8/8/4k3/8/8/r7/6K1 w - - 150 81");
+    parse_move(clock, "g1h1", quiet);
+    clock.make_move(quiet);
+    bool clock_over = !clock.to_packed(broken);
+
+    if (!bad_piece || !bad_castling || !bad_en_passant || !too_many || !clock_kept || !bad_clock || !clock_over) {
+        return false;
+    }
+
+    // only the first game of the PGN text has a result, its 10 positions are written
+    const char* path = "test_records.bin";
+    remove(path);
+
+    SearchLimits limits;
+    limits.nodes = 500;
+    int games;
+
+    {
+        TrainingWriter writer(path);
+        games = pgn_records(pgn_text, limits, 2, writer);
+    }
+
+    MappedFile file(path);
+    bool correct = games == 1 && file.is_open() && file.view().size() == 10 * sizeof(TrainingRecord);
+
+    if (correct) {
+
+        const TrainingRecord* records = reinterpret_cast<const TrainingRecord*>(file.view().data());
+
+        for (int i = 0; i < 10; i++) {
+            correct &= unpacked.set_packed(records[i].pos) == FEN_OK && unpacked.get_turn() == i % 2
+                       && records[i].result == (i % 2 ? -1 : 1);
+        }
+    }
+
+    remove(path);
+
+    return correct;
+}
+
+// test repetition detection by moving the knights out and back twice
+bool repetition() {
+
+    Board b;
+    Move moves[] = {Move(97, 76, EMPTY), Move(27, 46, EMPTY), Move(76, 97, EMPTY), Move(46, 27, EMPTY)};
+
+    for (Move m : moves) {
+        if (b.is_repetition()) {
+            return false;
+        }
+        b.make_move(m);
+    }
+
+    if (!b.is_repetition(1) || b.is_repetition(2)) {
+        return false;
+    }
+
+    for (Move m : moves) {
+        b.make_move(m);
+    }
+
+    return b.is_repetition(2) && !b.is_repetition(3);
+}
+// test storing, probing and replacing transposition table entries
+bool ttentries() {
+
+    TranspositionTable tt(1);
+    TTData data;
+
+    Board b;
+    Move m(85, 65, EMPTY, TWO_FORWARD);
+    Move unpacked = unpack_move(pack_move(m), b);
+
+    if (unpacked.start != m.start || unpacked.end != m.end || unpacked.flag != m.flag) {
+        return false;
+    }
+
+    tt.store(b.get_key(), pack_move(m), -321, 7, BOUND_LOWER);
+
+    if (!tt.probe(b.get_key(), data) || data.move != pack_move(m) || data.score != -321 || data.depth != 7 || data.bound != BOUND_LOWER) {
+        return false;
+    }
+
+    // a shallower bound of the same position doesn't replace a deeper one, an exact score or a new search does
+    tt.store(b.get_key(), 0, 50, 3, BOUND_UPPER);
+    bool kept = tt.probe(b.get_key(), data) && data.depth == 7 && data.score == -321;
+
+    tt.store(b.get_key(), 0, 50, 3, BOUND_EXACT);
+    bool exact = tt.probe(b.get_key(), data) && data.depth == 3 && data.bound == BOUND_EXACT && data.move == pack_move(m);
+
+    tt.store(b.get_key(), 0, -321, 7, BOUND_LOWER);
+    tt.new_search();
+    tt.store(b.get_key(), 0, 50, 3, BOUND_UPPER);
+    bool newer = tt.probe(b.get_key(), data) && data.depth == 3 && data.bound == BOUND_UPPER;
+
+    if (!kept || !exact || !newer) {
+        return false;
+    }
+
+    // keys that differ only in the low bits map to the same cluster, the shallowest entry is replaced
+    uint64_t key = 0xABCD000000000000ULL;
+
+    for (int i = 0; i < CLUSTER_SIZE; i++) {
+        tt.store(key + i, 0, 0, i + 1, BOUND_EXACT);
+    }
+
+    tt.store(key + CLUSTER_SIZE, 0, 0, 10, BOUND_EXACT);
+
+    if (tt.probe(key, data) || !tt.probe(key + 1, data) || !tt.probe(key + CLUSTER_SIZE, data) || data.depth != 10) {
+        return false;
+    }
+
+    return true;
+}
+
+// test if the search finds a back rank mate and scores stalemate as a draw
+bool searchmate() {
+
+    TranspositionTable tt(1);
+    SearchLimits limits;
+    limits.depth = 4;
+
+    Search mate(Board("6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"), tt);
+    SearchInfo result = mate.run(limits);
+
+    if (result.pv.empty() || move2str(result.pv[0]) != "d1d8" || result.score != MATE - 1) {
+        return false;
+    }
+
+    // a helper thread stopped in its first iteration has no completed result
+    atomic<bool> stop{true};
+    Search helper(Board(), tt, 1, &stop);
+
+    if (!result.completed || helper.run(limits).completed) {
+        return false;
+    }
+
+    Search stalemate(Board("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1"), tt);
+    result = stalemate.run(limits);
+
+    return result.pv.empty() && result.score == 0 && result.completed;
+}
+
+
+// FEN strings are written back unchanged, and malformed ones are rejected with the right error
+bool fenstrings() {
+
+    for (int i = 0; i < perft_positions_num; i++) {
+        Board b(perft_positions[i].fen);
+
+        if (b.to_fen() != perft_positions[i].fen) {
+            return false;
+        }
+    }
+
+    Board b;
+    b.make_move(Move(85, 65, EMPTY, TWO_FORWARD));
+
+    if (b.to_fen() != "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1") {
+        return false;
+    }
+
+    struct { const char* fen; FenError error; } bad[] = {
+        {"", FEN_BAD_PLACEMENT},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1", FEN_BAD_PLACEMENT},
+        {"rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FEN_BAD_PLACEMENT},
+        {"rnbqkbnr/ppppxppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FEN_BAD_PLACEMENT},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNRR w KQkq - 0 1", FEN_BAD_PLACEMENT},
+        {"rnbqkbnP/pppppppp/8/8/8/8/PPPPPPP1/RNBQKBNR w KQkq - 0 1", FEN_BAD_PLACEMENT},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/R\xce""BQKBNR w KQkq - 0 1", FEN_BAD_PLACEMENT},    // 0xce & 127 is 'N'
+        {"NNNNNNNN/NNN5/8/8/8/8/8/k6K w - - 0 1", FEN_BAD_PLACEMENT},                  // more than MAX_PIECES knights
+        {"k7/8/8/p7/pppppppp/8/8/7K w - - 0 1", FEN_BAD_PLACEMENT},                   // 9 pawns
+        {"k7/8/8/8/QQQQQQQQ/RRRRRRRR/8/7K w - - 0 1", FEN_BAD_PLACEMENT},             // 17 white pieces
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQQBNR w kq - 0 1", FEN_BAD_KINGS},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBKKBNR w kq - 0 1", FEN_BAD_KINGS},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", FEN_BAD_SIDE},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", FEN_BAD_SIDE},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkx - 0 1", FEN_BAD_CASTLING},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN1 w KQkq - 0 1", FEN_BAD_CASTLING},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e3 0 1", FEN_BAD_EN_PASSANT},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e6 0 1", FEN_BAD_EN_PASSANT},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e", FEN_BAD_EN_PASSANT},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 151 1", FEN_BAD_CLOCK},        // past the 75 move rule
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 300 1", FEN_BAD_CLOCK},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 0", FEN_BAD_CLOCK},
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0x 1", FEN_BAD_CLOCK},
+    };
+
+    for (auto& test : bad) {
+        if (b.set_fen(test.fen) != test.error) {
+            return false;
+        }
+    }
+
+    // the halfmove clock goes on past 127, and unmake_move sets it back
+    Board clock("8/8/8/4k3/8/8/8/r5K1 b - - 127 80");
+    Move rook_move;
+
+    if (!parse_move(clock, "a1a2", rook_move) || !clock.make_move(rook_move)
+        || clock.to_fen() != "8/8/8/4k3/8/8/r7/6K1 w - - 128 81") {
+        return false;
+    }
+
+    clock.unmake_move(rook_move);
+
+    if (clock.get_halfmove() != 127) {
+        return false;
+    }
+
+    // EPD lines, with and without move counters and operations
+    string epd = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - bm e4; id \"start\";\r\n"
+                 "# comment\n"
+                 "\n"
+                 "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1\n"
+                 "8/8/8/8/8/8/8/8 w - -\n"
+                 "4k3/8/8/8/8/8/8/4K3 b - -";
+
+    EpdStats stats = parse_epd(epd, b);
+
+    return stats.positions == 3 && stats.errors[FEN_BAD_KINGS] == 1 && b.to_fen() == "4k3/8/8/8/8/8/8/4K3 b - - 0 1";
+}
+
+// polyglot move: to file | to row << 3 | from file << 6 | from row << 9 (row 0 is rank 1)
+uint16_t polyglot_move(const char* move) {
+    return (move[2] - 'a') | (move[3] - '1') << 3 | (move[0] - 'a') << 6 | (move[1] - '1') << 9;
+}
+
+// keys of the polyglot book format specification, the pieces, castling rights, en passant and the side to play
+bool polyglot_keys() {
+
+    struct { const char* moves; uint64_t key; } positions[] = {
+        {"", 0x463B96181691FC9CULL},
+        {"e2e4", 0x823C9B50FD114196ULL},
+        {"e2e4 d7d5", 0x0756B94461C50FB0ULL},
+        {"e2e4 d7d5 e4e5", 0x662FAFB965DB29D4ULL},
+        {"e2e4 d7d5 e4e5 f7f5", 0x22A48B5A8E47FF78ULL},          // en passant capture possible
+        {"e2e4 d7d5 e4e5 f7f5 e1e2", 0x652A607CA3F242C1ULL},
+        {"e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00FDD303C946BDD9ULL},
+        {"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3C8123EA7B067637ULL},     // en passant capture possible
+        {"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5C3F9B829B279560ULL},
+    };
+
+    Book book;
+
+    for (auto& p : positions) {
+
+        Board b;
+        istringstream moves(p.moves);
+        string move;
+        Move m;
+
+        while (moves >> move) {
+            if (!parse_move(b, move, m)) {
+                return false;
+            }
+
+            b.make_move(m);
+        }
+
+        if (book.key(b) != p.key) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// write a small book with made up keys, and check lookup, castling moves and the weighted choice
+bool bookprobe() {
+
+    const char* keys_path = "test_book_keys.txt";
+    const char* book_path = "test_book.bin";
+
+    FILE* f = fopen(keys_path, "w");
+    uint64_t state = 1;
+
+    for (int i = 0; i < POLYGLOT_KEYS; i++) {
+        fprintf(f, "0x%016llX%s", (unsigned long long)splitmix64(state), i % 4 == 3 ? ",\n" : ", ");
+    }
+
+    fclose(f);
+
+    Book book;
+    book.load_keys(keys_path);
+
+    Board start;
+    Board castle("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+
+    vector<BookEntry> entries = {
+        {book.key(start), polyglot_move("e2e4"), 3, 0},
+        {book.key(start), polyglot_move("d2d4"), 1, 0},
+        {book.key(castle), polyglot_move("e1h1"), 1, 0},
+        {book.key(castle) + 1, polyglot_move("a1a2"), 1, 0},
+        {1, polyglot_move("a2a3"), 1, 0},
+    };
+
+    sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; });
+
+    f = fopen(book_path, "wb");
+
+    for (BookEntry& e : entries) {
+        uint64_t fields[4] = {e.key, e.move, e.weight, e.learn};
+        int sizes[4] = {8, 2, 2, 4};
+
+        for (int i = 0; i < 4; i++) {
+            for (int byte = sizes[i] - 1; byte >= 0; byte--) {
+                fputc(fields[i] >> (8 * byte) & 0xFF, f);
+            }
+        }
+    }
+
+    fclose(f);
+
+    bool correct = polyglot_keys() && book.open(book_path) && book.size() == 5 && book.find(start).size() == 2;
+
+    Move m;
+    int e4 = 0, d4 = 0;
+
+    for (int i = 0; i < 1000 && correct; i++) {
+        correct = book.probe(start, m);
+        e4 += move2str(m) == "e2e4";
+        d4 += move2str(m) == "d2d4";
+    }
+
+    correct = correct && e4 + d4 == 1000 && e4 > 650 && e4 < 850;
+    correct = correct && book.probe(castle, m) && m.flag == CASTLES && move2str(m) == "e1g1";
+
+    Board other("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+    correct = correct && !book.probe(other, m);
+
+    remove(keys_path);
+    remove(book_path);
+
+    return correct;
+}
+
+// 3 piece bitbases: known king and pawn positions, mirrored positions, and writing / reading them back
+bool bitbaseresults() {
+
+    generate_bitbases(2, false);
+
+    struct { const char* fen; Wdl result; } positions[] = {
+        {"4k3/4P3/4K3/8/8/8/8/8 w - - 0 1", WDL_WIN},       // Kd6 and the pawn promotes
+        {"4k3/4P3/4K3/8/8/8/8/8 b - - 0 1", WDL_DRAW},      // stalemate
+        {"8/8/4k3/8/4K3/4P3/8/8 w - - 0 1", WDL_DRAW},      // black has the opposition
+        {"8/8/4k3/8/4K3/4P3/8/8 b - - 0 1", WDL_LOSS},
+        {"k7/8/K7/P7/8/8/8/8 w - - 0 1", WDL_DRAW},         // rook pawn
+        {"8/8/4k3/4p3/4K3/8/8/8 w - - 0 1", WDL_DRAW},      // black pawn, mirrored
+        {"8/8/8/8/8/2k5/1q6/K7 w - - 0 1", WDL_LOSS},       // mate
+        {"8/8/8/8/8/2k5/q7/K7 w - - 0 1", WDL_DRAW},        // the queen is captured
+        {"8/8/8/3k4/8/8/8/KR6 b - - 0 1", WDL_LOSS},
+        {"8/8/8/3k4/8/8/8/KR6 w - - 0 1", WDL_WIN},
+        {"8/8/8/3k4/8/8/8/KR4R1 w - - 0 1", WDL_UNKNOWN},   // not a bitbase endgame
+    };
+
+    for (auto& test : positions) {
+        Board b(test.fen);
+
+        if (probe_bitbase(b) != test.result) {
+            return false;
+        }
+    }
+
+    const char* path = "test_bitbases.bin";
+    vector<Wdl> before;
+
+    for (size_t i = 0; i < bitbases[KPK].positions(); i += 997) {
+        before.push_back(bitbases[KPK].get(i));
+    }
+
+    bool correct = save_bitbases(path) && load_bitbases(path);
+    remove(path);
+
+    for (size_t i = 0, j = 0; i < bitbases[KPK].positions() && correct; i += 997, j++) {
+        correct = bitbases[KPK].get(i) == before[j];
+    }
+
+    return correct;
+}
+
+// uci commands: moves are applied, an infinite search runs until stop, and the time limits stay within the clock
+bool ucicommands() {
+
+    ostringstream out;
+
+    {
+        Uci uci(out);
+        uci.command("position startpos moves e2e4 e7e5 g1f3");
+        uci.command("go infinite");
+        this_thread::sleep_for(chrono::milliseconds(50));
+        uci.command("isready");
+        uci.command("stop");
+    }
+
+    string output = out.str();
+    size_t bestmove = output.find("bestmove ");
+
+    if (output.find("readyok") == string::npos || bestmove == string::npos || output.find("info depth 1") > bestmove) {
+        return false;
+    }
+
+    // the move after bestmove must be a legal black move
+    Board b;
+    Move m;
+
+    for (string move : {"e2e4", "e7e5", "g1f3"}) {
+        parse_move(b, move, m);
+        b.make_move(m);
+    }
+
+    if (!parse_move(b, output.substr(bestmove + 9, output.find_first_of(" \n", bestmove + 9) - bestmove - 9), m)) {
+        return false;
+    }
+
+    // a malformed FEN is ignored, the search is from the position before it
+    ostringstream bad_fen;
+
+    {
+        Uci uci(bad_fen);
+        uci.command("position startpos moves e2e4");
+        uci.command("position fen 8/8/8/8/8/8/8/8 w - - 0 1 moves e2e4");
+        uci.command("go depth 1");
+    }
+
+    output = bad_fen.str();
+    bestmove = output.find("bestmove ");
+    b.set_fen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+
+    if (output.find("info string bad kings") == string::npos || bestmove == string::npos
+        || !parse_move(b, output.substr(bestmove + 9, output.find_first_of(" \n", bestmove + 9) - bestmove - 9), m)) {
+        return false;
+    }
+
+    SearchLimits limits;
+    time_limits(limits, 1000, 0, 0);
+    bool sudden_death = limits.soft_time > 0 && limits.soft_time <= limits.movetime && limits.movetime < 1000;
+
+    time_limits(limits, 5000, 100, 1);
+    bool last_move = limits.soft_time <= limits.movetime && limits.movetime < 5000;
+
+    return sudden_death && last_move;
+}
 
 int main() {
 
     //cout << "rook moves correct: " << (rookmoves() ? "yes" : "no") << endl;
     //cout << "king moves correct: " << (kingmoves() ? "yes" : "no") << endl;
+    cout << "perft counts correct: " << (perftcounts() ? "yes" : "no") << endl;
+    cout << "parallel perft correct: " << (perftparallel() ? "yes" : "no") << endl;
+    cout << "perft edge cases correct: " << (perftedgecases() ? "yes" : "no") << endl;
+    cout << "zobrist keys correct: " << (zobristkeys() ? "yes" : "no") << endl;
+    cout << "incremental eval correct: " << (incrementaleval() ? "yes" : "no") << endl;
+    cout << "move picker correct: " << (movepicker() ? "yes" : "no") << endl;
+    cout << "static exchange correct: " << (staticexchange() ? "yes" : "no") << endl;
+    cout << "match games correct: " << (matchgames() ? "yes" : "no") << endl;
+    cout << "pgn replay correct: " << (pgnreplay() ? "yes" : "no") << endl;
+    cout << "packed positions correct: " << (packedpositions() ? "yes" : "no") << endl;
+    cout << "repetition correct: " << (repetition() ? "yes" : "no") << endl;
+    cout << "transposition table correct: " << (ttentries() ? "yes" : "no") << endl;
+    cout << "search finds mate: " << (searchmate() ? "yes" : "no") << endl;
+    cout << "fen strings correct: " << (fenstrings() ? "yes" : "no") << endl;
+    cout << "book probe correct: " << (bookprobe() ? "yes" : "no") << endl;
+    cout << "bitbases correct: " << (bitbaseresults() ? "yes" : "no") << endl;
+    cout << "uci commands correct: " << (ucicommands() ? "yes" : "no") << endl;
 
     cout << sizeof(State) << endl;
-    cout << sizeof(Stack) << endl;
-    cout << sizeof(State*) << endl;
     cout << sizeof(int*) << endl;
     cout << sizeof(Byte) << endl;
 
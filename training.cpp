@@ -0,0 +1,272 @@
+#include "training.hpp"
+#include "mapped_file.hpp"
+#include "pgn.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+TrainingWriter::TrainingWriter(const char* path) {
+    file = fopen(path, "ab");
+}
+
+TrainingWriter::~TrainingWriter() {
+    if (file) {
+        fclose(file);
+    }
+}
+
+bool TrainingWriter::write(const vector<TrainingRecord>& records) {
+
+    lock_guard<mutex> lock(write_lock);
+
+    if (!file || fwrite(records.data(), sizeof(TrainingRecord), records.size(), file) != records.size()) {
+        return false;
+    }
+
+    written += records.size();
+
+    return true;
+}
+
+uint64_t TrainingWriter::count() {
+    lock_guard<mutex> lock(write_lock);
+    return written;
+}
+
+// record of the position with the result still unknown, positions with more than 32 pieces are skipped
+static void add_record(vector<TrainingRecord>& records, Board& b, int score) {
+
+    TrainingRecord r;
+
+    if (b.to_packed(r.pos)) {
+        r.score = clamp(score, -32767, 32767);
+        r.result = 0;
+        records.push_back(r);
+    }
+}
+
+void set_results(vector<TrainingRecord>& records, int white_result) {
+
+    for (TrainingRecord& r : records) {
+        r.result = r.pos.turn_fullmove[1] >> 7 ? -white_result : white_result;
+    }
+}
+
+int selfplay_records(const vector<string>& openings, const MatchSettings& settings, TrainingWriter& writer, ostream& os) {
+
+    MatchSettings both = settings;
+    both.limits[1] = both.limits[0];
+
+    atomic<int> next_game{0};
+    atomic<int> played{0};
+    mutex os_lock;
+
+    auto start = chrono::steady_clock::now();
+
+    auto worker = [&]() {
+
+        TranspositionTable tts[2] = {TranspositionTable(both.hash_mb, false), TranspositionTable(both.hash_mb, false)};
+        vector<TrainingRecord> records;
+
+        while (true) {
+
+            int game = next_game++;
+
+            if (game >= both.max_games) {
+                break;
+            }
+
+            records.clear();
+
+            GameRecord record = play_game(openings[game % openings.size()], true, both, tts,
+                                          [&](Board& b, const SearchInfo& info) { add_record(records, b, info.score); });
+
+            set_results(records, record.score - 1);
+
+            if (!writer.write(records)) {
+                break;
+            }
+
+            int n = ++played;
+
+            if (n % 10 == 0) {
+                lock_guard<mutex> lock(os_lock);
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                os << "games " << n << "\trecords " << writer.count() << "\tgames/s " << n / max(seconds, 1e-9) << endl;
+            }
+        }
+    };
+
+    vector<thread> threads;
+
+    for (int i = 0; i < max(both.threads, 1); i++) {
+        threads.emplace_back(worker);
+    }
+
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    return played;
+}
+
+int pgn_records(string_view text, const SearchLimits& limits, int threads, TrainingWriter& writer) {
+
+    vector<string_view> parts = split_games(text, max(threads, 1));
+    atomic<int> used{0};
+    vector<thread> workers;
+
+    for (string_view part : parts) {
+
+        workers.emplace_back([&, part]() {
+
+            TranspositionTable tt(4, false);
+            Board b, position;
+            PgnReader reader(part);
+            PgnGame game;
+            vector<TrainingRecord> records;
+
+            while (reader.next(game)) {
+
+                string_view result = game.tag("Result");
+                int white_result = result == "1-0" ? 1 : result == "0-1" ? -1 : 0;
+
+                if (result != "1-0" && result != "0-1" && result != "1/2-1/2") {
+                    continue;
+                }
+
+                records.clear();
+                tt.clear();
+
+                // the search starts from the packed position without the moves before it, so the score
+                // depends only on what is stored, and long games don't overflow the history of the board
+                bool replayed = replay_game(game, b, [&](Board& board, Move) {
+
+                    PackedPosition packed;
+
+                    if (board.to_packed(packed) && position.set_packed(packed) == FEN_OK) {
+                        auto search = make_unique<Search>(position, tt);
+                        add_record(records, position, search->run(limits).score);
+                    }
+                });
+
+                if (replayed) {
+                    set_results(records, white_result);
+                    used += writer.write(records);
+                }
+            }
+        });
+    }
+
+    for (thread& t : workers) {
+        t.join();
+    }
+
+    return used;
+}
+
+bool selfplay_report(const char* epd_path, const char* out_path, const MatchSettings& settings, ostream& os) {
+
+    MappedFile file(epd_path);
+
+    if (!file.is_open()) {
+        os << "can't read " << epd_path << endl;
+        return false;
+    }
+
+    vector<string> openings = read_openings(file.view());
+
+    if (openings.empty()) {
+        os << "no positions in " << epd_path << endl;
+        return false;
+    }
+
+    TrainingWriter writer(out_path);
+
+    if (!writer.is_open()) {
+        os << "can't write " << out_path << endl;
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+    int games = selfplay_records(openings, settings, writer, os);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    os << "games " << games << "\trecords " << writer.count() << "\ttime " << int(seconds * 1000) << " ms"
+       << "\trecords/s " << uint64_t(writer.count() / max(seconds, 1e-9)) << endl;
+
+    return games == settings.max_games;
+}
+
+bool pgn_records_report(const char* pgn_path, const char* out_path, const SearchLimits& limits, int threads, ostream& os) {
+
+    MappedFile file(pgn_path);
+
+    if (!file.is_open()) {
+        os << "can't read " << pgn_path << endl;
+        return false;
+    }
+
+    TrainingWriter writer(out_path);
+
+    if (!writer.is_open()) {
+        os << "can't write " << out_path << endl;
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+    int games = pgn_records(file.view(), limits, threads, writer);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    os << "games " << games << "\trecords " << writer.count() << "\ttime " << int(seconds * 1000) << " ms"
+       << "\trecords/s " << uint64_t(writer.count() / max(seconds, 1e-9)) << endl;
+
+    return true;
+}
+
+bool records_report(const char* path, ostream& os) {
+
+    MappedFile file(path);
+
+    if (!file.is_open()) {
+        os << "can't read " << path << endl;
+        return false;
+    }
+
+    string_view view = file.view();
+
+    if (view.size() % sizeof(TrainingRecord)) {
+        os << path << " is not a record file (size " << view.size() << ")" << endl;
+        return false;
+    }
+
+    const TrainingRecord* records = reinterpret_cast<const TrainingRecord*>(view.data());
+    size_t n = view.size() / sizeof(TrainingRecord);
+
+    // unpack every position, like a tuner reading the file would
+    uint64_t results[3] = {0}, bad = 0;
+    Board b;
+
+    auto start = chrono::steady_clock::now();
+
+    for (size_t i = 0; i < n; i++) {
+
+        if (b.set_packed(records[i].pos) != FEN_OK || records[i].result < -1 || records[i].result > 1) {
+            bad++;
+            continue;
+        }
+
+        results[records[i].result + 1]++;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    os << "records " << n << "\tbad " << bad << "\twins " << results[2] << "\tdraws " << results[1] << "\tlosses " << results[0]
+       << "\ttime " << int(seconds * 1000) << " ms\trecords/s " << uint64_t(n / max(seconds, 1e-9)) << endl;
+
+    return bad == 0;
+}
@@ -0,0 +1,67 @@
+#ifndef TRAINING_H
+#define TRAINING_H
+
+#include "board.hpp"
+#include "match.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*  training data for tuning: records of a position, the score of a search of it and the result of its game.
+    a record file is an array of 32 byte records without a header, in the byte order of the machine. new games
+    are appended at the end, and the file can be memory mapped and read as TrainingRecord[] without any parsing,
+    the positions are unpacked with Board::set_packed.
+
+    records come from self-play games (the score of the search that chose the move) or from the games of
+    a PGN file with a result (every position is searched with the given limits).
+*/
+
+struct TrainingRecord {
+    PackedPosition pos;
+    int16_t score;          // search score from the side to play's point of view
+    int8_t result;          // game result from the side to play's point of view: 1 win, 0 draw, -1 loss
+    uint8_t unused = 0;
+};
+
+static_assert(sizeof(TrainingRecord) == 32);
+
+// appends records to a file, can be shared by threads
+class TrainingWriter {
+    private:
+        FILE* file;
+        mutex write_lock;
+        uint64_t written = 0;
+    public:
+        explicit TrainingWriter(const char* path);
+        ~TrainingWriter();
+        TrainingWriter(const TrainingWriter&) = delete;
+        TrainingWriter& operator=(const TrainingWriter&) = delete;
+
+        bool is_open() { return file != nullptr; }
+
+        // the records of a game are written together, returns false on a write error
+        bool write(const vector<TrainingRecord>& records);
+
+        uint64_t count();
+};
+
+// sets the result of every record from the game result of white (1, 0, -1)
+void set_results(vector<TrainingRecord>& records, int white_result);
+
+// play games from the openings (in turn) with limits[0] for both sides, and write a record of every searched position
+// returns the number of games played
+int selfplay_records(const vector<string>& openings, const MatchSettings& settings, TrainingWriter& writer, ostream& os);
+
+// search every position of the games of a PGN text that have a result, and write a record of it
+// returns the number of games used
+int pgn_records(string_view text, const SearchLimits& limits, int threads, TrainingWriter& writer);
+
+// modes of main: generate records from self-play or a PGN file, and read a record file
+bool selfplay_report(const char* epd_path, const char* out_path, const MatchSettings& settings, ostream& os);
+bool pgn_records_report(const char* pgn_path, const char* out_path, const SearchLimits& limits, int threads, ostream& os);
+bool records_report(const char* path, ostream& os);
+
+#endif //TRAINING_H
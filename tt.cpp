@@ -0,0 +1,181 @@
+#include "tt.hpp"
+#include <assert.h>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+// packed data: move (16 bits) | score (16) | depth (8) | bound (2) | generation (6)
+
+static uint64_t pack_data(uint16_t move, int score, int depth, Bound bound, uint8_t generation) {
+    return move | uint64_t(uint16_t(score)) << 16 | uint64_t(uint8_t(depth)) << 32
+         | uint64_t(bound) << 40 | uint64_t(generation) << 42;
+}
+
+static int data_depth(uint64_t data) { return int8_t(data >> 32); }
+static Bound data_bound(uint64_t data) { return Bound((data >> 40) & 3); }
+static uint8_t data_generation(uint64_t data) { return data >> 42; }
+
+
+uint16_t pack_move(Move m) {
+    return board120[m.start] | board120[m.end] << 6 | m.flag << 12;
+}
+
+Move unpack_move(uint16_t packed, Board& b) {
+
+    Byte start = board64[packed & 63];
+    Byte end = board64[(packed >> 6) & 63];
+
+    return Move(start, end, b.get(end), Flag(packed >> 12));
+}
+
+
+TranspositionTable::TranspositionTable(size_t mb, bool use_huge_pages) {
+    resize(mb, use_huge_pages);
+}
+
+TranspositionTable::~TranspositionTable() {
+    free_table();
+}
+
+void TranspositionTable::free_table() {
+    free(clusters);
+    clusters = nullptr;
+    cluster_num = 0;
+}
+
+// allocate a table of given size in MB, the old entries are lost
+// with use_huge_pages the table is aligned to 2 MB and the kernel is asked to back it with huge pages,
+// this saves a TLB miss on most probes of a table much larger than the cache
+void TranspositionTable::resize(size_t mb, bool use_huge_pages) {
+
+    free_table();
+
+    cluster_num = max(mb * 1024 * 1024 / sizeof(TTCluster), size_t(1));
+    size_t bytes = cluster_num * sizeof(TTCluster);
+
+#ifdef __linux__
+    const size_t huge_page = 2 * 1024 * 1024;
+
+    if (use_huge_pages && bytes >= huge_page) {
+
+        size_t rounded = (bytes + huge_page - 1) / huge_page * huge_page;
+        clusters = (TTCluster*)aligned_alloc(huge_page, rounded);
+
+        if (clusters) {
+            madvise(clusters, rounded, MADV_HUGEPAGE);
+        }
+    }
+#endif
+
+    if (!clusters) {
+        clusters = (TTCluster*)aligned_alloc(alignof(TTCluster), bytes);
+    }
+
+    assert(clusters);
+    clear();
+}
+
+void TranspositionTable::clear() {
+    memset((void*)clusters, 0, cluster_num * sizeof(TTCluster));
+    generation = 0;
+}
+
+// call at the start of every search, entries of older searches are replaced first
+void TranspositionTable::new_search() {
+    generation = (generation + 1) & 63;
+}
+
+// look up a position, returns true if an entry with the same key was found
+bool TranspositionTable::probe(uint64_t key, TTData& out) {
+
+    TTCluster* c = cluster(key);
+
+    for (TTEntry& e : c->entries) {
+
+        uint64_t data = e.data.load(memory_order_relaxed);
+        uint64_t key_xor_data = e.key_xor_data.load(memory_order_relaxed);
+
+        if ((key_xor_data ^ data) == key && data_bound(data) != BOUND_NONE) {
+
+            out.move = data & 0xFFFF;
+            out.score = int16_t(data >> 16);
+            out.depth = data_depth(data);
+            out.bound = data_bound(data);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// save a search result, replaces the entry of the same position or else the least valuable entry of the cluster
+void TranspositionTable::store(uint64_t key, uint16_t move, int score, int depth, Bound bound) {
+
+    assert(score >= INT16_MIN && score <= INT16_MAX && depth >= INT8_MIN && depth <= INT8_MAX);
+
+    TTCluster* c = cluster(key);
+    TTEntry* replace = nullptr;
+    int lowest = INT_MAX;
+
+    for (TTEntry& e : c->entries) {
+
+        uint64_t data = e.data.load(memory_order_relaxed);
+        uint64_t key_xor_data = e.key_xor_data.load(memory_order_relaxed);
+
+        if ((key_xor_data ^ data) == key) {     // same position, keep the old move if there is no new one
+
+            // a deeper result of this search (maybe from another thread) is kept, unless the new one is exact
+            if (bound != BOUND_EXACT && data_generation(data) == generation && depth < data_depth(data)) {
+                return;
+            }
+
+            if (!move) {
+                move = data & 0xFFFF;
+            }
+
+            replace = &e;
+            break;
+        }
+
+        // value of an entry is its depth, minus 8 for every search since it was stored
+        int value = data_bound(data) == BOUND_NONE ? INT_MIN : data_depth(data) - 8 * ((generation - data_generation(data)) & 63);
+
+        if (value < lowest) {
+            lowest = value;
+            replace = &e;
+        }
+    }
+
+    uint64_t data = pack_data(move, score, depth, bound, generation);
+
+    replace->data.store(data, memory_order_relaxed);
+    replace->key_xor_data.store(key ^ data, memory_order_relaxed);
+}
+
+// permill of the table filled by the current search (estimated from the first 1000 clusters)
+int TranspositionTable::hashfull() {
+
+    size_t sample = min(cluster_num, size_t(1000));
+    size_t used = 0;
+
+    for (size_t i = 0; i < sample; i++) {
+        for (TTEntry& e : clusters[i].entries) {
+
+            uint64_t data = e.data.load(memory_order_relaxed);
+            used += data_bound(data) != BOUND_NONE && data_generation(data) == generation;
+        }
+    }
+
+    return used * 1000 / (sample * CLUSTER_SIZE);
+}
+
+size_t TranspositionTable::size_mb() {
+    return cluster_num * sizeof(TTCluster) / (1024 * 1024);
+}
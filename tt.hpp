@@ -0,0 +1,78 @@
+#ifndef TT_H
+#define TT_H
+
+#include "board.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*  transposition table: a hash table of search results indexed by the zobrist key of the position.
+
+    the table is an array of 64 byte clusters (one cache line) with 4 entries each, a key maps to one cluster.
+    an entry is 2 words: the packed data and key ^ data. threads read and write entries without locks,
+    if two threads write the same entry at the same time the words of the result don't match the key anymore
+    and the entry is ignored by probe (see https://www.chessprogramming.org/Shared_Hash_Table#Lockless).
+
+    when a cluster is full the entry with the lowest depth (minus a penalty for old searches) is replaced.
+    an entry of the same position is replaced unless it is deeper and from the same search, and the new one isn't exact.
+*/
+
+enum Bound : uint8_t {
+    BOUND_NONE  = 0,
+    BOUND_UPPER = 1,    // score <= alpha (fail low)
+    BOUND_LOWER = 2,    // score >= beta (fail high)
+    BOUND_EXACT = 3
+};
+
+struct TTData {
+    uint16_t move;      // packed move, 0 -> no move (see pack_move)
+    int score;
+    int depth;
+    Bound bound;
+};
+
+// a move in 16 bits: start square (6 bits), end square (6 bits) and flag (3 bits), squares as board64 indices
+uint16_t pack_move(Move m);
+
+// unpacks a move, the captured piece is taken from the board
+Move unpack_move(uint16_t packed, Board& b);
+
+const int CLUSTER_SIZE = 4;
+
+struct TTEntry {
+    std::atomic<uint64_t> key_xor_data;
+    std::atomic<uint64_t> data;
+};
+
+struct alignas(64) TTCluster {
+    TTEntry entries[CLUSTER_SIZE];
+};
+
+class TranspositionTable {
+    private:
+        TTCluster* clusters = nullptr;
+        size_t cluster_num = 0;
+        uint8_t generation = 0;             // 6 bits, increased every search to age the entries
+
+        TTCluster* cluster(uint64_t key) { return &clusters[(unsigned __int128)key * cluster_num >> 64]; }
+        void free_table();
+    public:
+        explicit TranspositionTable(size_t mb = 16, bool use_huge_pages = true);
+        ~TranspositionTable();
+        TranspositionTable(const TranspositionTable&) = delete;
+        TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+        void resize(size_t mb, bool use_huge_pages = true);
+        void clear();
+        void new_search();
+        bool probe(uint64_t key, TTData& out);
+        void store(uint64_t key, uint16_t move, int score, int depth, Bound bound);
+        int hashfull();
+        size_t size_mb();
+
+        // start loading the cluster of a key into the cache, call it right after make_move so the
+        // memory latency overlaps with other work before the probe
+        void prefetch(uint64_t key) { __builtin_prefetch(cluster(key)); }
+};
+
+#endif //TT_H
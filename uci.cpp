@@ -0,0 +1,273 @@
+#include "uci.hpp"
+#include "bitbase.hpp"
+#include <algorithm>
+
+using namespace std;
+
+// the soft limit is an equal share of the remaining time plus most of the increment,
+// the hard limit allows an iteration that takes longer than expected to finish, but never more than 3/4 of the time left
+void time_limits(SearchLimits& limits, int time, int inc, int movestogo) {
+
+    int available = max(time - MOVE_OVERHEAD, 1);
+    int moves = movestogo > 0 ? movestogo : 30;
+
+    limits.soft_time = max(min(available / moves + inc * 3 / 4, available * 3 / 4), 1);
+    limits.movetime = max(min(limits.soft_time * 3, available * 3 / 4), 1);
+}
+
+bool parse_move(Board& b, const string& str, Move& move) {
+
+    MoveList moves;
+    b.generate_moves(moves);
+
+    for (Move m : moves) {
+        if (move2str(m) == str) {
+            move = m;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+Uci::Uci(ostream& out) : tt(16), search(tt, 1), out(out) {}
+
+Uci::~Uci() {
+    stop();
+    wait_search();
+}
+
+void Uci::send(const string& line) {
+    lock_guard<mutex> lock(out_lock);
+    out << line << endl;
+}
+
+// wait until the running search (if any) has sent its bestmove
+void Uci::wait_search() {
+    if (search_thread.joinable()) {
+        search_thread.join();
+    }
+}
+
+// position [startpos | fen <fen>] [moves <move1> ... <movei>]
+// a malformed FEN is reported and the command ignored, the position stays as it was
+void Uci::position(istringstream& is) {
+
+    string token, fen;
+    is >> token;
+
+    if (token == "startpos") {
+        fen = FEN_START;
+        is >> token;
+    } else if (token == "fen") {
+        while (is >> token && token != "moves") {
+            fen += (fen.empty() ? "" : " ") + token;
+        }
+    } else {
+        return;
+    }
+
+    Board parsed;
+    FenError error = parsed.set_fen(fen);
+
+    if (error != FEN_OK) {
+        send("info string " + fen_error_str[error] + " in fen " + fen);
+        return;
+    }
+
+    board = parsed;
+
+    Move m;
+    while (is >> token && parse_move(board, token, m)) {
+        board.make_move(m, false);
+    }
+}
+
+// go [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>] [depth <n>] [nodes <n>] [movetime <ms>] [infinite] [ponder]
+void Uci::go(istringstream& is) {
+
+    SearchLimits limits;
+    int time[2] = {0, 0}, inc[2] = {0, 0}, movestogo = 0;
+    bool ponder = false;
+    string token;
+
+    infinite = false;
+
+    while (is >> token) {
+        if (token == "wtime") is >> time[0];
+        else if (token == "btime") is >> time[1];
+        else if (token == "winc") is >> inc[0];
+        else if (token == "binc") is >> inc[1];
+        else if (token == "movestogo") is >> movestogo;
+        else if (token == "depth") is >> limits.depth;
+        else if (token == "nodes") is >> limits.nodes;
+        else if (token == "movetime") is >> limits.movetime;
+        else if (token == "infinite") infinite = true;
+        else if (token == "ponder") ponder = true;
+    }
+
+    // book moves are played without searching
+    Move book_move;
+
+    if (own_book && !infinite && !ponder && book.is_open() && book.probe(board, book_move)) {
+        send("bestmove " + move2str(book_move));
+        return;
+    }
+
+    int us = board.get_turn();
+
+    if (time[us]) {
+        time_limits(limits, time[us], inc[us], movestogo);
+    }
+
+    limits.depth = clamp(limits.depth, 1, MAX_PLY - 1);
+    hold = infinite || ponder;
+    stop_requested = false;
+    search.set_pondering(ponder);
+
+    search.on_iteration = [this](const SearchInfo& info) {
+
+        ostringstream os;
+        print_info(info, os);
+
+        string line = os.str();
+        line.pop_back();    // print_info ends with a newline
+        send(line);
+
+        // a stop that came before the search reset its stop flag
+        if (stop_requested) {
+            search.stop();
+        }
+    };
+
+    search_thread = thread([this, limits]() {
+
+        SearchInfo result = search.run(board, limits);
+
+        // in infinite and ponder mode the bestmove is only sent after stop or ponderhit
+        {
+            unique_lock<mutex> lock(hold_lock);
+            hold_wake.wait(lock, [this]() { return !hold; });
+        }
+
+        if (result.pv.empty()) {
+            send("bestmove 0000");
+        } else if (result.pv.size() > 1) {
+            send("bestmove " + move2str(result.pv[0]) + " ponder " + move2str(result.pv[1]));
+        } else {
+            send("bestmove " + move2str(result.pv[0]));
+        }
+    });
+}
+
+// setoption name <id> [value <x>]
+void Uci::setoption(istringstream& is) {
+
+    string token, name, value;
+    is >> token;
+
+    while (is >> token && token != "value") {
+        name += (name.empty() ? "" : " ") + token;
+    }
+
+    // values can contain spaces (file names)
+    getline(is >> ws, value);
+
+    if (name == "Hash") {
+        tt.resize(clamp(atoi(value.c_str()), 1, 65536));
+    } else if (name == "Threads") {
+        search.set_threads(clamp(atoi(value.c_str()), 1, 256));
+    } else if (name == "Clear Hash") {
+        tt.clear();
+    } else if (name == "OwnBook") {
+        own_book = value == "true";
+    } else if (name == "Book File") {
+        book.open(value.c_str());
+    } else if (name == "Book Keys") {
+        book.load_keys(value.c_str());
+    } else if (name == "Bitbases" && value == "true") {
+        generate_bitbases(search.get_threads(), false);
+    } else if (name == "Bitbase File") {
+        load_bitbases(value.c_str());
+    }
+}
+
+void Uci::stop() {
+
+    stop_requested = true;
+    search.stop();
+
+    lock_guard<mutex> lock(hold_lock);
+    hold = false;
+    hold_wake.notify_all();
+}
+
+// the opponent played the expected move, the ponder search continues as a normal search
+void Uci::ponderhit() {
+
+    search.set_pondering(false);
+
+    lock_guard<mutex> lock(hold_lock);
+    if (!infinite) {
+        hold = false;
+        hold_wake.notify_all();
+    }
+}
+
+bool Uci::command(const string& line) {
+
+    istringstream is(line);
+    string token;
+    is >> token;
+
+    if (token == "uci") {
+        send("id name chess_engine");
+        send("option name Hash type spin default 16 min 1 max 65536");
+        send("option name Threads type spin default 1 min 1 max 256");
+        send("option name Clear Hash type button");
+        send("option name Ponder type check default false");
+        send("option name OwnBook type check default false");
+        send("option name Book File type string default <empty>");
+        send("option name Book Keys type string default <empty>");
+        send("option name Bitbases type check default false");
+        send("option name Bitbase File type string default <empty>");
+        send("uciok");
+    } else if (token == "isready") {
+        send("readyok");
+    } else if (token == "ucinewgame") {
+        wait_search();
+        tt.clear();
+    } else if (token == "position") {
+        wait_search();
+        position(is);
+    } else if (token == "go") {
+        wait_search();
+        go(is);
+    } else if (token == "stop") {
+        stop();
+        wait_search();
+    } else if (token == "ponderhit") {
+        ponderhit();
+    } else if (token == "setoption") {
+        wait_search();
+        setoption(is);
+    } else if (token == "d") {
+        ostringstream os;
+        os << board;
+        send(os.str());
+    } else if (token == "quit") {
+        stop();
+        wait_search();
+        return false;
+    }
+
+    return true;
+}
+
+void Uci::loop(istream& in) {
+
+    string line;
+
+    while (getline(in, line) && command(line)) {}
+}
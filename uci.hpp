@@ -0,0 +1,62 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include "board.hpp"
+#include "book.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+/*  universal chess interface: commands are read line by line from the gui, the search runs on its own thread
+    so commands like stop, ponderhit and isready are answered while it searches.
+    see https://www.chessprogramming.org/UCI
+*/
+
+const int MOVE_OVERHEAD = 10;       // ms kept back for communication with the gui
+
+// soft and hard time limit for one move, from the remaining time, increment and moves to the next time control
+void time_limits(SearchLimits& limits, int time, int inc, int movestogo);
+
+class Uci {
+    private:
+        Board board;
+        TranspositionTable tt;
+        SmpSearch search;
+        thread search_thread;
+        Book book;
+        bool own_book = false;
+
+        ostream& out;
+        mutex out_lock;                     // info lines come from the search thread
+
+        mutex hold_lock;
+        condition_variable hold_wake;
+        bool hold = false;                  // go infinite / go ponder: bestmove waits for stop or ponderhit
+        bool infinite = false;
+        std::atomic<bool> stop_requested{false};
+
+        void send(const string& line);
+        void wait_search();
+
+        void position(istringstream& is);
+        void go(istringstream& is);
+        void setoption(istringstream& is);
+        void stop();
+        void ponderhit();
+    public:
+        explicit Uci(ostream& out);
+        ~Uci();
+
+        // handle one command, returns false on quit
+        bool command(const string& line);
+        void loop(istream& in);
+};
+
+// find the legal move in long algebraic notation (e2e4, e7e8q), returns false if there is none
+bool parse_move(Board& b, const string& str, Move& move);
+
+#endif //UCI_H
@@ -0,0 +1,56 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+/*  zobrist hashing: every (piece, square) pair, castling rights combination, en passant file and the side to play
+    gets a random 64 bit number, and the key of a position is the xor of the numbers of everything in it.
+    a move changes only a few of these, so Board::make_move updates the key with a few xors.
+    see https://www.chessprogramming.org/Zobrist_Hashing
+
+    the numbers are generated at compile time (splitmix64 with a fixed seed), so keys are the same in every build.
+*/
+
+struct ZobristKeys {
+    uint64_t pieces[15][64];    // [Piece::val][square index of board64]
+    uint64_t castling[16];      // [castle_rights]
+    uint64_t en_passant[8];     // [file of en passant square]
+    uint64_t side;              // black to play
+};
+
+constexpr uint64_t splitmix64(uint64_t& state) {
+
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys make_zobrist_keys() {
+
+    ZobristKeys keys{};
+    uint64_t state = 20220807;
+
+    for (int piece = 0; piece < 15; piece++) {
+        for (int sq = 0; sq < 64; sq++) {
+            keys.pieces[piece][sq] = splitmix64(state);
+        }
+    }
+
+    for (int i = 0; i < 16; i++) {
+        keys.castling[i] = splitmix64(state);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        keys.en_passant[i] = splitmix64(state);
+    }
+
+    keys.side = splitmix64(state);
+
+    return keys;
+}
+
+inline constexpr ZobristKeys zobrist = make_zobrist_keys();
+
+#endif //ZOBRIST_H